@@ -0,0 +1,208 @@
+import std;
+import utils;
+import day1;
+import day2;
+import day3;
+import day4;
+import day5;
+import day6;
+import day7;
+import day8;
+import day9;
+
+using utils::pretty::Color;
+using utils::pretty::colored;
+
+constexpr std::array days{
+    utils::day::entry<Day1>(1),
+    utils::day::entry<Day2>(2),
+    utils::day::entry<Day3>(3),
+    utils::day::entry<Day4>(4),
+    utils::day::entry<Day5>(5),
+    utils::day::entry<Day6>(6),
+    utils::day::entry<Day7>(7),
+    utils::day::entry<Day8>(8),
+    utils::day::entry<Day9>(9),
+};
+
+constexpr std::string_view usage = R"(usage: aoc [options]
+  --day <n>         run day n, may be given several times (default: every day)
+  --part <1|2>      only solve one part (default: both)
+  --input <path>    input file, "-" is stdin (default: <inputs>/<n>.txt), needs exactly one --day
+  --stream          read the input block by block, for days that support it
+  --repeat <n>      solve every day n times and report the median and fastest time of each phase
+  --sequential      solve the two parts of a day one after the other instead of concurrently, so that neither part
+                    is timed while the other competes for its cores (the total then is the sum of the phases)
+  --parallel        solve the selected days at the same time instead of one after the other. Faster overall, but the
+                    days and their own worker threads share the cores, so the timings of each phase grow
+  --bench <n>       benchmark every phase with n timed runs instead of solving
+  --json <path>     write the benchmark report to path, needs exactly one --day
+)";
+
+struct Options {
+    std::vector<int> days;
+    std::optional<std::filesystem::path> input;
+    bool stream = false;
+    bool parallel = false;
+    bool help = false;
+    utils::day::Run_options run;
+};
+
+auto entry_of(int day) -> const utils::day::Entry&
+{
+    const auto found = std::ranges::find(days, day, &utils::day::Entry::number);
+    if (found == days.end()) {
+        throw std::invalid_argument(std::format("there is no day {}", day));
+    }
+    return *found;
+}
+
+/// Parses the command line left over after the bench options were taken out
+auto parse_args(int argc, char** argv) -> Options
+{
+    Options options;
+    auto next_value = [&](int& i) -> std::string_view {
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(std::format("missing value for '{}'", argv[i]));
+        }
+        return argv[++i];
+    };
+    auto next_number = [&](int& i) -> std::size_t {
+        const std::string_view flag = argv[i];
+        const auto value = next_value(i);
+        std::size_t number = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+        if (error != std::errc{} || end != value.data() + value.size() || number == 0) {
+            throw std::invalid_argument(std::format("invalid value '{}' for '{}'", value, flag));
+        }
+        return number;
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--day") {
+            options.days.push_back(entry_of(static_cast<int>(next_number(i))).number);
+        }
+        else if (arg == "--part") {
+            const auto part = next_number(i);
+            if (part > 2) {
+                throw std::invalid_argument(std::format("there is no part {}", part));
+            }
+            options.run.parts = part == 1 ? utils::day::Parts::first : utils::day::Parts::second;
+        }
+        else if (arg == "--input") {
+            options.input = std::filesystem::path{next_value(i)};
+        }
+        else if (arg == "--repeat") {
+            options.run.repeats = next_number(i);
+        }
+        else if (arg == "--stream") {
+            options.stream = true;
+        }
+        else if (arg == "--sequential") {
+            options.run.schedule = utils::day::Schedule::sequential;
+        }
+        else if (arg == "--parallel") {
+            options.parallel = true;
+        }
+        else if (arg == "--help" || arg == "-h") {
+            options.help = true;
+        }
+        else {
+            throw std::invalid_argument(std::format("unknown argument '{}'\n{}", arg, usage));
+        }
+    }
+
+    if (options.days.empty()) {
+        for (const auto& day : days) {
+            options.days.push_back(day.number);
+        }
+    }
+    if (options.input && options.days.size() != 1) {
+        throw std::invalid_argument("--input needs exactly one --day");
+    }
+    return options;
+}
+
+auto input_path(const Options& options, int day) -> std::filesystem::path
+{
+    return options.input.value_or(utils::io::input_path(day));
+}
+
+auto solve(const utils::day::Entry& day, const Options& options) -> utils::day::Report
+{
+    if (options.stream) {
+        if (!day.solve_stream) {
+            throw std::invalid_argument(std::format("day {} cannot stream its input", day.number));
+        }
+        return day.solve_stream(input_path(options, day.number), options.run);
+    }
+    const auto input = utils::io::Input::open(input_path(options, day.number));
+    return day.solve(input, options.run);
+}
+
+/// Checks and solves the selected days, then prints their reports in order. The days run one after another unless
+/// `--parallel` was given, since days 3, 6 and 7 already spread over every core and would otherwise be timed on an
+/// oversubscribed machine.
+auto run(const Options& options) -> int
+{
+    const auto count = options.days.size();
+    std::vector<std::string> reports(count);
+    std::vector<std::string> errors(count);
+    const auto solve_day = [&](std::size_t i) {
+        const auto& day = entry_of(options.days[i]);
+        try {
+            day.check();
+            reports[i] = utils::day::format_report(day.number, solve(day, options));
+        }
+        catch (const std::exception& e) {
+            errors[i] = std::format("day {}: {}", day.number, e.what());
+        }
+    };
+    utils::parallel::for_each_index(count, solve_day, options.parallel ? utils::parallel::worker_count() : 1);
+
+    int status = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::print("{}", reports[i]);
+        if (!errors[i].empty()) {
+            std::println(std::cerr, "{}", colored(Color::red, errors[i]));
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/// Benchmarks the selected days one after another, so that they do not compete for cores
+auto bench(const Options& options, const utils::bench::Options& bench_options) -> int
+{
+    if (bench_options.json && options.days.size() != 1) {
+        throw std::invalid_argument("--json needs exactly one --day");
+    }
+    int status = 0;
+    for (const int number : options.days) {
+        const auto& day = entry_of(number);
+        day.check();
+        const auto input = utils::io::Input::open(input_path(options, number));
+        utils::bench::Harness harness{std::format("day{}", number), input, bench_options};
+        day.bench(harness, input);
+        status = std::max(status, harness.report());
+    }
+    return status;
+}
+
+auto main(int argc, char** argv) -> int
+{
+    try {
+        const auto bench_options = utils::bench::Options::from_args(argc, argv);
+        const auto options = parse_args(argc, argv);
+        if (options.help) {
+            std::print("{}", usage);
+            return 0;
+        }
+        return bench_options ? bench(options, *bench_options) : run(options);
+    }
+    catch (const std::exception& e) {
+        std::println(std::cerr, "{}", colored(Color::red, e.what()));
+        return 1;
+    }
+}
@@ -1,56 +1,129 @@
+export module day1;
+
 import std;
 import utils;
 
 using namespace utils::assert;
+namespace str = utils::strings;
+
 
+struct Lists {
+    std::vector<int> left;
+    std::vector<int> right;
+};
 
-auto parse(std::string_view input) -> std::pair<std::vector<int>, std::vector<int>>
+auto parse(std::string_view input) -> Lists
 {
-    std::stringstream stream{input};
-    std::vector<int> left, right;
-    int a, b;
-    while (stream >> a >> b) {
-        left.push_back(a);
-        right.push_back(b);
+    std::vector<int> buffer(input.size() / 2 + 1);
+    const auto values = str::parse_ints<int>(input, buffer);
+    Lists lists{std::vector<int>(values.size() / 2), std::vector<int>(values.size() / 2)};
+    for (std::size_t i = 0; i < lists.left.size(); ++i) {
+        lists.left[i] = values[2 * i];
+        lists.right[i] = values[2 * i + 1];
     }
-    return {left, right};
+    return lists;
 }
 
+/// Bits sorted per radix pass, two passes cover the 5 digit location ids
+constexpr unsigned radix_bits = 11;
+/// Largest value the similarity score counts in a dense histogram
+constexpr int histogram_limit = 1 << 20;
+
+/// The largest of `ids`, or nullopt if any of them is negative and only the comparison paths apply
+auto non_negative_max(std::span<const int> ids) -> std::optional<int>
+{
+    if (ids.empty()) return 0;
+    const auto [smallest, largest] = std::ranges::minmax(ids);
+    return smallest < 0 ? std::nullopt : std::optional{largest};
+}
 
-auto puzzle1(std::string_view input) -> int
+/// LSD radix sort of values in [0, max_value], `radix_bits` at a time
+auto radix_sort(std::span<int> values, int max_value) -> void
 {
-    auto [left, right] = parse(input);
+    constexpr std::size_t buckets = 1uz << radix_bits;
+    std::vector<int> scratch(values.size());
+    std::span<int> from = values;
+    std::span<int> to = scratch;
+    for (unsigned shift = 0; shift < 32 && (static_cast<unsigned>(max_value) >> shift) != 0; shift += radix_bits) {
+        const auto digit = [=](int value) { return (static_cast<unsigned>(value) >> shift) & (buckets - 1); };
+        std::array<std::size_t, buckets> starts{};
+        for (const int value : from) {
+            ++starts[digit(value)];
+        }
+        std::exclusive_scan(starts.begin(), starts.end(), starts.begin(), 0uz);
+        for (const int value : from) {
+            to[starts[digit(value)]++] = value;
+        }
+        std::swap(from, to);
+    }
+    if (from.data() != values.data()) std::ranges::copy(from, values.begin());
+}
 
-    std::ranges::sort(left);
-    std::ranges::sort(right);
+/// Sorts location ids with a linear radix sort when they are non-negative and need at most two passes, with a
+/// comparison sort otherwise
+auto sort_ids(std::span<int> ids) -> void
+{
+    const auto max_value = non_negative_max(ids);
+    if (max_value && std::bit_width(static_cast<unsigned>(*max_value)) <= 2 * radix_bits) {
+        radix_sort(ids, *max_value);
+    }
+    else {
+        std::ranges::sort(ids);
+    }
+}
 
+auto total_distance(Lists lists) -> int
+{
+    sort_ids(lists.left);
+    sort_ids(lists.right);
     return std::ranges::fold_left(
-        std::views::zip(left, right)
+        std::views::zip(lists.left, lists.right)
             | std::views::transform([](std::pair<int, int> pair) { return std::abs(pair.first - pair.second); }),
         0,
         std::plus{}
     );
 }
 
-auto puzzle2(std::string_view input) -> int
+/// Every left id times how often it appears on the right. Small non-negative ids are counted in a dense histogram in
+/// linear time, anything else is sorted and merged.
+auto similarity_score(const Lists& lists) -> int
 {
-    auto [left, right] = parse(input);
-    std::ranges::sort(right);
-    const auto map = right //
-                   | std::views::chunk_by(std::equal_to{})
-                   | std::views::transform([](auto x) { return std::pair{*x.begin(), std::ranges::distance(x)}; })
-                   | std::ranges::to<std::unordered_map>();
-    return std::ranges::fold_left(
-        left //
-            | std::views::transform([&](const int e) {
-                  auto it = map.find(e);
-                  return e * (it != map.end() ? it->second : 0);
-              }),
-        0,
-        std::plus{}
-    );
+    const auto max_value = non_negative_max(lists.right);
+    if (max_value && *max_value < histogram_limit) {
+        std::vector<int> counts(static_cast<std::size_t>(*max_value) + 1);
+        for (const int id : lists.right) {
+            ++counts[static_cast<std::size_t>(id)];
+        }
+        return std::ranges::fold_left(
+            lists.left | std::views::transform([&](int id) {
+                return id >= 0 && id <= *max_value ? id * counts[static_cast<std::size_t>(id)] : 0;
+            }),
+            0,
+            std::plus{}
+        );
+    }
+
+    auto left = lists.left;
+    auto right = lists.right;
+    sort_ids(left);
+    sort_ids(right);
+    int score = 0;
+    auto match = right.begin();
+    for (const int id : left) {
+        match = std::lower_bound(match, right.end(), id);
+        score += id * static_cast<int>(std::upper_bound(match, right.end(), id) - match);
+    }
+    return score;
 }
 
+export struct Day1 {
+    using Parsed = Lists;
+    static auto parse(std::string_view input) -> Lists { return ::parse(input); }
+    static auto part1(const Lists& lists) -> int { return total_distance(lists); }
+    static auto part2(const Lists& lists) -> int { return similarity_score(lists); }
+    static auto check() -> void;
+};
+
 
 constexpr std::string_view test_input = R"(3   4
 4   3
@@ -60,17 +133,9 @@ constexpr std::string_view test_input = R"(3   4
 3   3
 )";
 
-auto main() -> int
+auto Day1::check() -> void
 {
-    assert_eq(puzzle1(test_input), 11);
-    assert_eq(puzzle2(test_input), 31);
-
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/1.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+    const auto test = utils::day::run<Day1>(test_input);
+    assert_eq(test.part1, 11);
+    assert_eq(test.part2, 31);
 }
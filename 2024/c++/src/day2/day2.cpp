@@ -1,52 +1,96 @@
+export module day2;
+
 import std;
 import utils;
 
 using namespace utils::assert;
+namespace str = utils::strings;
 
-auto parse(std::string_view input) -> std::vector<std::vector<int>>
+auto parse(std::string_view input) -> utils::Jagged<int>
 {
-    return input.substr(0, input.size() - 1) | std::views::split('\n') | std::views::transform([](auto&& line) {
-               std::stringstream stream{line | std::ranges::to<std::string>()};
-               std::vector<int> res;
-               int x;
-               while (stream >> x) {
-                   res.push_back(x);
-               }
-               return res;
-           })
-         | std::ranges::to<std::vector>();
+    const auto lines = input | str::trim;
+    utils::Jagged<int> reports;
+    reports.reserve(std::ranges::count(lines, '\n') + 1, lines.size() / 2 + 1);
+    for (std::string_view line : lines | str::split('\n')) {
+        reports.emplace_row(line.size() / 2 + 1, [=](std::span<int> out) {
+            return str::parse_ints<int>(line, out).size();
+        });
+    }
+    return reports;
 }
 
-constexpr auto is_safe = [](std::ranges::range auto& report) -> bool {
-    return std::ranges::distance(report | std::views::chunk_by([](int a, int b) {
-                                     int diff = std::abs(a - b);
-                                     return diff >= 1 && diff <= 3;
-                                 }))
-            == 1
-        && (std::ranges::is_sorted(report, std::less{}) || std::ranges::is_sorted(report, std::greater{}));
-};
-
-auto puzzle1(std::string_view input) -> int { return std::ranges::count_if(parse(input), is_safe); }
+/// Whether removing at most `K` levels leaves a strictly increasing or decreasing report with steps of 1 to 3.
+/// Walks the report once and only remembers the last K + 1 levels, together with the fewest removals needed to end a
+/// rising or falling run at each of them.
+export template <std::size_t K>
+constexpr auto is_safe_with_removals(std::ranges::input_range auto&& report) -> bool
+{
+    struct Kept {
+        int level;
+        std::size_t rising;
+        std::size_t falling;
+    };
+    constexpr std::size_t window = K + 1;
+    std::array<Kept, window> recent{};
+    std::size_t n = 0;
+    std::size_t dead_streak = 0;
+    for (const int level : report) {
+        Kept kept{level, std::min(n, window), std::min(n, window)};
+        for (std::size_t back = 1; back <= std::min(n, window); ++back) {
+            const Kept& prev = recent[(n - back) % window];
+            const int step = level - prev.level;
+            if (step >= 1 && step <= 3) kept.rising = std::min(kept.rising, prev.rising + back - 1);
+            if (step <= -1 && step >= -3) kept.falling = std::min(kept.falling, prev.falling + back - 1);
+        }
+        recent[n % window] = kept;
+        ++n;
+        // once a whole window needs more than K removals, no later level can be reached cheaper
+        dead_streak = std::min(kept.rising, kept.falling) > K ? dead_streak + 1 : 0;
+        if (dead_streak == window) return false;
+    }
+    for (std::size_t back = 1; back <= std::min(n, window); ++back) {
+        const Kept& last = recent[(n - back) % window];
+        if (std::min(last.rising, last.falling) + back - 1 <= K) return true;
+    }
+    return n == 0;
+}
 
-auto options(std::span<const int> report) -> std::vector<std::vector<int>>
+template <std::size_t K>
+auto count_safe(const utils::Jagged<int>& reports) -> int
 {
-    auto indices = std::views::iota(0uz, report.size());
-    return indices | std::views::transform([&](std::size_t exclude) {
-               return std::views::zip(report, indices)
-                    | std::views::filter([=](auto pair) { return pair.second != exclude; }) //
-                    | std::views::keys                                                      //
-                    | std::ranges::to<std::vector>();
-           })
-         | std::ranges::to<std::vector>();
+    return static_cast<int>(std::ranges::count_if(reports, [](std::span<const int> report) {
+        return is_safe_with_removals<K>(report);
+    }));
 }
-auto puzzle2(std::string_view input) -> int
+
+/// Reference for `is_safe_with_removals`: tries every way of removing up to `k` levels
+auto is_safe_by_brute_force(const std::vector<int>& report, std::size_t k) -> bool
 {
-    return std::ranges::count(
-        parse(input) | std::views::transform([](std::span<int> x) { return std::ranges::any_of(options(x), is_safe); }),
-        true
-    );
+    bool rising = true;
+    bool falling = true;
+    for (std::size_t i = 1; i < report.size(); ++i) {
+        const int step = report[i] - report[i - 1];
+        rising = rising && step >= 1 && step <= 3;
+        falling = falling && step >= -3 && step <= -1;
+    }
+    if (rising || falling) return true;
+    if (k == 0) return false;
+    for (std::size_t i = 0; i < report.size(); ++i) {
+        auto shorter = report;
+        shorter.erase(shorter.begin() + static_cast<std::ptrdiff_t>(i));
+        if (is_safe_by_brute_force(shorter, k - 1)) return true;
+    }
+    return false;
 }
 
+export struct Day2 {
+    using Parsed = utils::Jagged<int>;
+    static auto parse(std::string_view input) -> Parsed { return ::parse(input); }
+    static auto part1(const Parsed& reports) -> int { return count_safe<0>(reports); }
+    static auto part2(const Parsed& reports) -> int { return count_safe<1>(reports); }
+    static auto check() -> void;
+};
+
 
 constexpr std::string_view test_input = R"(7 6 4 2 1
 1 2 7 8 9
@@ -56,18 +100,23 @@ constexpr std::string_view test_input = R"(7 6 4 2 1
 1 3 6 7 9
 )";
 
-auto main() -> int
+auto Day2::check() -> void
 {
-    assert_eq(puzzle1(test_input), 2);
-    assert_eq(puzzle2(test_input), 4);
-
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/2.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
+    const auto test = utils::day::run<Day2>(test_input);
+    assert_eq(test.part1, 2);
+    assert_eq(test.part2, 4);
 
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+    // more than one removal has to agree with trying every removal
+    const std::vector<std::vector<int>> reports{
+        {1, 9, 2, 3, 10, 4},
+        {5, 1, 2, 9, 3, 4, 8},
+        {10, 8, 20, 6, 4, 30, 2},
+        {1, 2, 9, 9, 9, 3, 4},
+        {7, 3, 8, 2, 9, 1, 10},
+        {1, 5, 9, 13, 17},
+    };
+    for (const auto& report : reports) {
+        assert_eq(is_safe_with_removals<2>(report), is_safe_by_brute_force(report, 2));
+        assert_eq(is_safe_with_removals<3>(report), is_safe_by_brute_force(report, 3));
+    }
 }
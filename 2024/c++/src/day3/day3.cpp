@@ -1,97 +1,275 @@
+export module day3;
+
 import std;
 import utils;
 
 using namespace utils::assert;
-namespace str = utils::strings;
 
-using Parse_result = std::optional<std::string_view>;
+/// Table driven recogniser for `mul(a,b)`, `do()` and `don't()` with 1 to 3 digit operands
+namespace dfa {
 
-auto parse_num(int& out)
-{
-    return [&out](std::string_view sv) -> Parse_result {
-        const char* last = sv.end();
-        auto res = std::from_chars(sv.data(), last, out);
-        if (res.ec == std::errc::invalid_argument)
-            return std::nullopt;
-        else {
-            return std::optional{std::string_view{res.ptr, last}};
+enum State : std::uint8_t {
+    start,
+    m,
+    mu,
+    mul,
+    mul_open,
+    a1,
+    a2,
+    a3,
+    comma,
+    b1,
+    b2,
+    b3,
+    d,
+    do_,
+    do_open,
+    don,
+    don_,
+    dont,
+    dont_open,
+    mul_done,
+    do_done,
+    dont_done,
+    n_states
+};
+
+using Table = std::array<std::array<State, 256>, n_states>;
+
+constexpr Table table = [] {
+    Table table{};
+    // a mismatch restarts on the current character. that is all the backtracking needed, because 'm' and 'd' only
+    // ever appear as the first character of a token
+    for (auto& row : table) {
+        row.fill(start);
+        row['m'] = m;
+        row['d'] = d;
+    }
+    const auto on = [&](State from, std::string_view chars, State to) {
+        for (char c : chars) {
+            table[from][static_cast<unsigned char>(c)] = to;
         }
     };
-}
+    constexpr std::string_view digits = "0123456789";
+    on(m, "u", mu);
+    on(mu, "l", mul);
+    on(mul, "(", mul_open);
+    on(mul_open, digits, a1);
+    on(a1, digits, a2);
+    on(a2, digits, a3);
+    on(a1, ",", comma);
+    on(a2, ",", comma);
+    on(a3, ",", comma);
+    on(comma, digits, b1);
+    on(b1, digits, b2);
+    on(b2, digits, b3);
+    on(b1, ")", mul_done);
+    on(b2, ")", mul_done);
+    on(b3, ")", mul_done);
+    on(d, "o", do_);
+    on(do_, "(", do_open);
+    on(do_open, ")", do_done);
+    on(do_, "n", don);
+    on(don, "'", don_);
+    on(don_, "t", dont);
+    on(dont, "(", dont_open);
+    on(dont_open, ")", dont_done);
+    return table;
+}();
+
+} // namespace dfa
+
+/// Sums the `mul`s of a corrupted memory dump in one pass without recursion. Between tokens a SIMD search jumps to
+/// the next 'm' or 'd', every byte after that costs one table lookup.
+struct Scanner {
+    dfa::State state = dfa::start;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    bool enabled = true;
+    /// sum of all products
+    std::uint64_t total = 0;
+    /// sum of the products that were not disabled by `don't()`
+    std::uint64_t enabled_total = 0;
+    /// sum of the products before the first `do()` or `don't()`
+    std::uint64_t untoggled_total = 0;
+    bool toggled = false;
+
+    auto step(char c) -> void
+    {
+        const auto digit = static_cast<std::uint32_t>(c - '0');
+        state = dfa::table[state][static_cast<unsigned char>(c)];
+        switch (state) {
+        case dfa::a1:
+            a = digit;
+            break;
+        case dfa::a2:
+        case dfa::a3:
+            a = a * 10 + digit;
+            break;
+        case dfa::b1:
+            b = digit;
+            break;
+        case dfa::b2:
+        case dfa::b3:
+            b = b * 10 + digit;
+            break;
+        case dfa::mul_done:
+            total += a * b;
+            enabled_total += enabled ? a * b : 0;
+            untoggled_total += toggled ? 0 : a * b;
+            state = dfa::start;
+            break;
+        case dfa::do_done:
+            enabled = true;
+            toggled = true;
+            state = dfa::start;
+            break;
+        case dfa::dont_done:
+            enabled = false;
+            toggled = true;
+            state = dfa::start;
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// Consumes `text`, a token may continue in the next call
+    auto feed(std::string_view text) -> void
+    {
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            if (state == dfa::start) {
+                const auto next = utils::simd::find_either(text.substr(pos), 'm', 'd');
+                if (next == std::string_view::npos) return;
+                pos += next;
+            }
+            step(text[pos++]);
+        }
+    }
 
-auto parse_text(std::string_view pat)
+    /// Completes a token cut off at the end of the last `feed` by reading on into `following`. Tokens that start in
+    /// `following` are left alone.
+    auto finish_token(std::string_view following) -> void
+    {
+        for (char c : following) {
+            if (state == dfa::start) return;
+            step(c);
+            // 'm' and 'd' only lead to these states as the first character of a new token
+            if (state == dfa::m || state == dfa::d) {
+                state = dfa::start;
+                return;
+            }
+        }
+    }
+};
+
+/// Scans a sequence of blocks as if they were one input, tokens may be split anywhere
+auto scan_blocks(std::ranges::input_range auto&& blocks) -> Scanner
 {
-    return [pat](std::string_view sv) -> Parse_result {
-        // std::println("match: '{}' ? {}", pat, sv);
-        return sv.starts_with(pat) ? std::optional{std::string_view{sv.begin() + pat.size(), sv.end()}} : std::nullopt;
-    };
+    Scanner scanner;
+    for (std::string_view block : blocks) {
+        scanner.feed(block);
+    }
+    return scanner;
 }
 
-struct Parse_mul_value {
-    std::string_view sv;
-    int a;
-    int b;
-};
-auto parse_mul(std::string_view sv) -> std::optional<Parse_mul_value>
+/// Scans a file or stdin ("-") that may be larger than memory, holding one block at a time
+auto scan_stream(const std::filesystem::path& path, std::size_t block_size = 1uz << 20) -> Scanner
 {
-    int a, b;
-    return parse_text("mul(")(sv)
-        .and_then(parse_num(a))
-        .and_then(parse_text(","))
-        .and_then(parse_num(b))
-        .and_then(parse_text(")"))
-        .transform([&](std::string_view sv) { return Parse_mul_value{sv, a, b}; });
+    Scanner scanner;
+    utils::io::Block_reader reader{path, block_size};
+    while (const auto block = reader.next()) {
+        scanner.feed(*block);
+    }
+    return scanner;
 }
 
+/// What a chunk contributes independent of the `do()`/`don't()` state it starts in
+struct Summary {
+    std::uint64_t total = 0;
+    /// enabled sum if the chunk starts enabled
+    std::uint64_t if_enabled = 0;
+    /// enabled sum if the chunk starts disabled
+    std::uint64_t if_disabled = 0;
+    /// state after the chunk, nullopt if it does not toggle and passes on the state it started in
+    std::optional<bool> final_state;
+};
 
-constexpr auto drop_first = std::views::drop(1) | str::to_sv;
-auto puzzle1(std::string_view input) -> int
+/// Summary of `lhs` directly followed by `rhs`. This is associative with `Summary{}` as identity.
+constexpr auto combine(const Summary& lhs, const Summary& rhs) -> Summary
 {
-    return input.empty() ? 0
-                         : parse_mul(input) //
-                               .transform([](auto val) { return val.a * val.b + puzzle1(val.sv); })
-                               .or_else([=] { return std::optional{puzzle1(input | drop_first)}; })
-                               .value();
+    return Summary{
+        .total = lhs.total + rhs.total,
+        .if_enabled = lhs.if_enabled + (lhs.final_state.value_or(true) ? rhs.if_enabled : rhs.if_disabled),
+        .if_disabled = lhs.if_disabled + (lhs.final_state.value_or(false) ? rhs.if_enabled : rhs.if_disabled),
+        .final_state = rhs.final_state ? rhs.final_state : lhs.final_state,
+    };
 }
 
+/// What the tokens a scanner has consumed contribute
+auto summary_of(const Scanner& scanner) -> Summary
+{
+    return Summary{
+        .total = scanner.total,
+        .if_enabled = scanner.enabled_total,
+        // only the products before the first toggle depend on the initial state
+        .if_disabled = scanner.enabled_total - scanner.untoggled_total,
+        .final_state = scanner.toggled ? std::optional{scanner.enabled} : std::nullopt,
+    };
+}
 
-auto next_state(std::string_view sv, bool current) -> std::pair<std::string_view, bool>
+/// Summarizes the tokens that start in `chunk`, the last of which may end in `following`
+auto summarize(std::string_view chunk, std::string_view following) -> Summary
 {
-    return parse_text("don't")(sv) //
-        .transform([](std::string_view sv) { return std::pair{sv, false}; })
-        .or_else([=] { return parse_text("do")(sv).transform([](std::string_view sv) { return std::pair{sv, true}; }); }
-        )
-        .value_or(std::pair{sv, current});
+    Scanner scanner;
+    scanner.feed(chunk);
+    scanner.finish_token(following);
+    return summary_of(scanner);
 }
 
-auto parse_recursive2(std::string_view input, bool state) -> int
+/// Summarizes chunks of `chunk_size` bytes on all cores, then folds the summaries in input order
+auto scan_parallel(std::string_view input, std::size_t chunk_size = 1uz << 20) -> Summary
 {
-    auto [sv, new_state] = next_state(input, state);
-    return sv.empty() ? 0
-                      : parse_mul(input)
-                            .transform([=](auto val) {
-                                return (new_state ? val.a * val.b : 0) + parse_recursive2(val.sv, new_state);
-                            })
-                            .or_else([=] { return std::optional{parse_recursive2(input | drop_first, new_state)}; })
-                            .value();
+    const auto count = (input.size() + chunk_size - 1) / chunk_size;
+    std::vector<Summary> summaries(count);
+    utils::parallel::for_each_index(count, [&](std::size_t i) {
+        const auto begin = i * chunk_size;
+        const auto end = std::min(begin + chunk_size, input.size());
+        summaries[i] = summarize(input.substr(begin, end - begin), input.substr(end));
+    });
+    return std::ranges::fold_left(summaries, Summary{}, combine);
 }
 
-auto puzzle2(std::string_view input) -> int { return parse_recursive2(input, true); }
+/// One scan of the memory dump yields both sums, the parts only pick theirs
+export struct Day3 {
+    using Parsed = Summary;
+    static auto parse(std::string_view input) -> Summary { return scan_parallel(input); }
+    static auto part1(const Summary& summary) -> std::uint64_t { return summary.total; }
+    static auto part2(const Summary& summary) -> std::uint64_t { return summary.if_enabled; }
+    /// Reads a file or stdin block by block, for inputs larger than memory
+    static auto parse_stream(const std::filesystem::path& path) -> Summary { return summary_of(scan_stream(path)); }
+    static auto check() -> void;
+};
 
 
 constexpr std::string_view test_input = R"(xmul(2,4)&mul[3,7]!^don't()_mul(5,5)+mul(32,64](mul(11,8)undo()?mul(8,5)))";
-auto main() -> int
+auto Day3::check() -> void
 {
-    assert_eq(puzzle1(test_input), 161);
-    assert_eq(puzzle2(test_input), 48);
-
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/3.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+    const auto test = utils::day::run<Day3>(test_input);
+    assert_eq(test.part1, 161);
+    assert_eq(test.part2, 48);
+    for (std::size_t block_size : {1uz, 2uz, 5uz, 7uz}) {
+        const auto blocks = std::views::iota(0uz, (test_input.size() + block_size - 1) / block_size)
+                          | std::views::transform([=](std::size_t i) {
+                                return test_input.substr(i * block_size, block_size);
+                            });
+        const auto scanner = scan_blocks(blocks);
+        assert_eq(scanner.total, 161);
+        assert_eq(scanner.enabled_total, 48);
+
+        const auto summary = scan_parallel(test_input, block_size);
+        assert_eq(summary.total, 161);
+        assert_eq(summary.if_enabled, 48);
+    }
 }
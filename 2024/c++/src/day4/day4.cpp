@@ -1,104 +1,121 @@
+export module day4;
+
 import std;
 import utils;
 
 using namespace utils::assert;
-using namespace std::string_view_literals;
-namespace str = utils::strings;
-using utils::Range_of;
-
-using Text_matrix = std::mdspan<const char, std::dextents<std::size_t, 2>>;
-using Mat_index = std::pair<std::size_t, std::size_t>;
 
+/// The grid as one bitset per row for each letter of "XMAS": bit x of a row is set iff cell (x, y) holds the letter.
+/// Patterns are matched for 64 cells at once by shifting the neighbouring rows into place and and-ing them.
+class Bit_planes {
+    static constexpr std::string_view letters = "XMAS";
+    /// empty rows around each plane and empty words around each row, so neighbours can be read without bounds checks
+    static constexpr std::size_t pad_rows = 3;
+    static constexpr std::size_t pad_words = 1;
 
-auto count_occurrences(Range_of<char> auto text) -> std::size_t
-{
-    return str::count_matches(text, "XMAS") + str::count_matches(text | std::views::reverse, "XMAS");
-}
-
-auto count_occurrences(std::ranges::range auto range) -> std::size_t
-{
-    return utils::sum(range | std::views::transform([](Range_of<char> auto r) { return count_occurrences(r); }));
-}
-
+    std::size_t height;
+    std::size_t words;
+    std::vector<std::uint64_t> bits;
 
-enum struct Diag_dir { down_left, down_right };
-auto diagonals(Diag_dir direction, Text_matrix mat) -> auto
-{
-    auto height = mat.extent(0);
-    auto width = mat.extent(1);
-    auto indices = std::views::iota(0uz, std::max(width, height) * 2) //
-                 | std::views::transform([=](std::size_t n) {
-                       auto range = std::views::iota(0uz, n);
-                       return std::views::zip(range | std::views::reverse, range) //
-                            | std::views::transform([=](Mat_index pair) {
-                                  return direction == Diag_dir::down_right
-                                           ? pair
-                                           : Mat_index{height - 1 - pair.first, pair.second};
-                              });
-                   })
-                 | std::views::transform(
-                       std::views::filter([=](auto pair) { return pair.first < height && pair.second < width; })
-                       | std::views::transform([mat](auto pair) { return mat[pair.first, pair.second]; })
-                 );
-    return indices;
-}
+    auto row_offset(std::size_t letter, std::ptrdiff_t y) const -> std::size_t
+    {
+        const auto padded_y = static_cast<std::size_t>(y + static_cast<std::ptrdiff_t>(pad_rows));
+        return (letter * (height + 2 * pad_rows) + padded_y) * (words + 2 * pad_words) + pad_words;
+    }
 
+    /// Word `w` of `row`, moved so that bit x holds cell x + dx
+    template <int dx>
+    static auto shifted(const std::uint64_t* row, std::size_t w) -> std::uint64_t
+    {
+        if constexpr (dx == 0) {
+            return row[w];
+        }
+        else if constexpr (dx > 0) {
+            return (row[w] >> dx) | (row[w + 1] << (64 - dx));
+        }
+        else {
+            return (row[w] << -dx) | (row[w - 1] >> (64 + dx));
+        }
+    }
 
-auto verticals(Text_matrix mat) -> auto // Range_of<Range_of<char>>
-{
-    return std::views::iota(0uz, mat.extent(1)) | std::views::transform([=](std::size_t x) {
-               return std::views::iota(0uz, mat.extent(0))
-                    | std::views::transform([=](std::size_t y) { return mat[y, x]; });
-           });
-}
+    /// "XMAS" starting at any cell and heading in direction (dx, dy)
+    template <int dx, int dy>
+    auto count_xmas() const -> std::size_t
+    {
+        std::size_t count = 0;
+        for (std::ptrdiff_t y = 0; y < static_cast<std::ptrdiff_t>(height); ++y) {
+            const auto* xs = row(X, y);
+            const auto* ms = row(M, y + dy);
+            const auto* as = row(A, y + 2 * dy);
+            const auto* ss = row(S, y + 3 * dy);
+            for (std::size_t w = 0; w < words; ++w) {
+                const auto matches = xs[w] & shifted<dx>(ms, w) & shifted<2 * dx>(as, w) & shifted<3 * dx>(ss, w);
+                count += static_cast<std::size_t>(std::popcount(matches));
+            }
+        }
+        return count;
+    }
 
+public:
+    enum Letter : std::size_t { X, M, A, S };
 
-auto puzzle1(std::string_view text) -> int
-{
-    std::size_t width = text.find_first_of('\n') + 1;
-    std::size_t height = text.size() / width;
-    Text_matrix mat{text.data(), height, width};
-    // print_mat(mat);
-
-    return count_occurrences(text)           //
-         + count_occurrences(verticals(mat)) //
-         + count_occurrences(diagonals(Diag_dir::down_right, mat))
-         + count_occurrences(diagonals(Diag_dir::down_left, mat));
-}
+    explicit Bit_planes(std::string_view text)
+    {
+        const auto width = std::min(text.find('\n'), text.size());
+        const auto stride = width + 1;
+        height = (text.size() + 1) / stride;
+        words = (width + 63) / 64;
+        bits.resize(letters.size() * (height + 2 * pad_rows) * (words + 2 * pad_words));
+        for (std::size_t letter = 0; letter < letters.size(); ++letter) {
+            for (std::ptrdiff_t y = 0; y < static_cast<std::ptrdiff_t>(height); ++y) {
+                const auto line = text.substr(static_cast<std::size_t>(y) * stride, width);
+                utils::simd::byte_masks(line, letters[letter], std::span{bits}.subspan(row_offset(letter, y), words));
+            }
+        }
+    }
 
-struct Sliding_window {
-    Text_matrix source;
-    std::size_t y_offset;
-    std::size_t x_offset;
+    /// Row `y` of a letter, rows up to 3 outside the grid read as empty
+    auto row(Letter letter, std::ptrdiff_t y) const -> const std::uint64_t*
+    {
+        return bits.data() + row_offset(letter, y);
+    }
 
-    auto operator[](std::size_t y, std::size_t x) const -> char
+    /// "XMAS" in all 8 directions
+    auto count_xmas() const -> std::size_t
     {
-        assert_lt(y + y_offset, source.extent(0));
-        assert_lt(x + x_offset, source.extent(1));
-        return source[y + y_offset, x + x_offset];
+        return count_xmas<1, 0>() + count_xmas<-1, 0>() + count_xmas<0, 1>() + count_xmas<0, -1>()
+             + count_xmas<1, 1>() + count_xmas<-1, -1>() + count_xmas<1, -1>() + count_xmas<-1, 1>();
     }
-    auto is_xmas(this Sliding_window self) -> bool
+
+    /// An 'A' with "MAS" forwards or backwards on both diagonals through it
+    auto count_x_mas() const -> std::size_t
     {
-        auto ms1 = std::string{self[0, 0], self[2, 2]};
-        auto ms2 = std::string{self[0, 2], self[2, 0]};
-        return self[1, 1] == 'A' && (ms1 == "MS" || ms1 == "SM") && (ms2 == "MS" || ms2 == "SM");
+        std::size_t count = 0;
+        for (std::ptrdiff_t y = 0; y < static_cast<std::ptrdiff_t>(height); ++y) {
+            const auto* as = row(A, y);
+            const auto* ms_above = row(M, y - 1);
+            const auto* ss_above = row(S, y - 1);
+            const auto* ms_below = row(M, y + 1);
+            const auto* ss_below = row(S, y + 1);
+            for (std::size_t w = 0; w < words; ++w) {
+                const auto down_right = (shifted<-1>(ms_above, w) & shifted<1>(ss_below, w))
+                                      | (shifted<-1>(ss_above, w) & shifted<1>(ms_below, w));
+                const auto down_left = (shifted<1>(ms_above, w) & shifted<-1>(ss_below, w))
+                                     | (shifted<1>(ss_above, w) & shifted<-1>(ms_below, w));
+                count += static_cast<std::size_t>(std::popcount(as[w] & down_right & down_left));
+            }
+        }
+        return count;
     }
 };
 
-auto puzzle2(std::string_view text) -> int
-{
-    std::size_t width = text.find_first_of('\n') + 1;
-    std::size_t height = text.size() / width;
-    Text_matrix mat{text.data(), height, width};
-
-    auto xmases = std::views::iota(0uz, height - 2) //
-                | std::views::transform([=](std::size_t y) {
-                      return std::views::iota(0uz, width - 2) //
-                           | std::views::transform([=](std::size_t x) { return Sliding_window{mat, y, x}.is_xmas(); });
-                  })
-                | std::views::join;
-    return std::ranges::count(xmases, true);
-}
+export struct Day4 {
+    using Parsed = Bit_planes;
+    static auto parse(std::string_view text) -> Bit_planes { return Bit_planes{text}; }
+    static auto part1(const Bit_planes& planes) -> std::size_t { return planes.count_xmas(); }
+    static auto part2(const Bit_planes& planes) -> std::size_t { return planes.count_x_mas(); }
+    static auto check() -> void;
+};
 
 
 constexpr std::string_view test_input = R"(MMMSXXMASM
@@ -113,18 +130,16 @@ MAMMMXMMMM
 MXMXAXMASX
 )";
 
-auto main() -> int
+auto Day4::check() -> void
 {
-    assert_eq(puzzle1(test_input), 18);
-    assert_eq(puzzle2(test_input), 9);
-
-
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/4.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+    const auto test = utils::day::run<Day4>(test_input);
+    assert_eq(test.part1, 18);
+    assert_eq(test.part2, 9);
+
+    // the generic grid search has to agree with the bit planes
+    const auto test_grid = utils::grid::from_text(test_input);
+    const utils::grid::Word_search xmas{"XMAS", "SAMX"};
+    const utils::grid::Stencil_search x_mas{"M.S\n.A.\nM.S", "M.M\n.A.\nS.S", "S.M\n.A.\nS.M", "S.S\n.A.\nM.M"};
+    assert_eq(xmas.count(test_grid), 18);
+    assert_eq(x_mas.count(test_grid), 9);
 }
@@ -1,3 +1,5 @@
+export module day5;
+
 import std;
 import utils;
 
@@ -5,64 +7,302 @@ using namespace utils::assert;
 namespace str = utils::strings;
 namespace views = std::views;
 namespace ranges = std::ranges;
-using namespace std::string_view_literals;
-using utils::pretty::Color;
-using utils::pretty::colored;
 
-auto parse(std::string_view text) -> std::pair<std::set<std::pair<int, int>>, std::vector<std::vector<int>>>
+/// A set of pages as a bitset, one bit per page number
+using Page_set = std::vector<std::uint64_t>;
+
+/// Number of pages in `set` below `page`, i.e. the position of `page` among the members of `set`
+auto position_in(const Page_set& set, std::size_t page) -> std::size_t
 {
-    constexpr auto parse_ints = views::transform(str::parse_num<int>) | views::transform(utils::opt_value);
-    const auto [constraint_text, updates_text] = utils::range_to_pair(text | str::split("\n\n"));
-    const auto constraints = constraint_text //
-                           | str::split('\n')
-                           | views::transform(
-                                 str::split('|') //
-                                 | parse_ints
-                           )
-                           | views::transform(utils::range_to_pair) //
-                           | ranges::to<std::set>();
-    const auto updates = updates_text //
-                       | str::split_whitespace
-                       | views::transform(
-                             str::split(',') //
-                             | parse_ints    //
-                             | ranges::to<std::vector>()
-                       )
-                       | ranges::to<std::vector>();
-    return std::pair{constraints, updates};
+    std::size_t position = 0;
+    for (std::size_t w = 0; w < page / 64; ++w) {
+        position += static_cast<std::size_t>(std::popcount(set[w]));
+    }
+    const auto below = (std::uint64_t{1} << (page % 64)) - 1;
+    return position + static_cast<std::size_t>(std::popcount(set[page / 64] & below));
 }
 
-auto get_sort_func(const std::set<std::pair<int, int>>& constraints)
+/// The ordering rules as two dense bit matrices: bit `after` of successor row `before` is set iff there is a rule
+/// "before|after", the predecessor rows hold the same bits transposed. Page numbers are small, so asking whether two
+/// pages are ordered is one load and a mask.
+class Ordering_rules {
+    static constexpr std::size_t max_pages = 1uz << 12;
+
+    std::size_t pages = 0;
+    std::size_t words = 0;
+    std::vector<std::uint64_t> successor_bits;
+    std::vector<std::uint64_t> predecessor_bits;
+
+public:
+    /// `pairs` holds the rules flattened to before, after, before, after, ...
+    explicit Ordering_rules(std::span<const int> pairs)
+    {
+        if (pairs.empty()) return;
+        const auto [smallest, largest] = ranges::minmax(pairs);
+        if (smallest < 0 || static_cast<std::size_t>(largest) >= max_pages) {
+            throw std::invalid_argument(std::format("page numbers have to be in [0, {})", max_pages));
+        }
+        pages = static_cast<std::size_t>(largest) + 1;
+        words = (pages + 63) / 64;
+        successor_bits.resize(pages * words);
+        predecessor_bits.resize(pages * words);
+        for (std::size_t i = 0; i + 1 < pairs.size(); i += 2) {
+            const auto before = static_cast<std::size_t>(pairs[i]);
+            const auto after = static_cast<std::size_t>(pairs[i + 1]);
+            successor_bits[before * words + after / 64] |= std::uint64_t{1} << (after % 64);
+            predecessor_bits[after * words + before / 64] |= std::uint64_t{1} << (before % 64);
+        }
+    }
+
+    /// Pages are numbered [0, page_count()), larger numbers appear in no rule
+    auto page_count() const -> std::size_t { return pages; }
+    auto successors(std::size_t page) const -> std::span<const std::uint64_t>
+    {
+        return std::span{successor_bits}.subspan(page * words, words);
+    }
+    auto predecessors(std::size_t page) const -> std::span<const std::uint64_t>
+    {
+        return std::span{predecessor_bits}.subspan(page * words, words);
+    }
+
+    /// Whether a rule puts `before` ahead of `after`. Pages that appear in no rule are not ordered.
+    auto contains(int before, int after) const -> bool
+    {
+        const auto b = static_cast<std::size_t>(before);
+        const auto a = static_cast<std::size_t>(after);
+        return b < pages && a < pages && (successor_bits[b * words + a / 64] >> (a % 64) & 1) != 0;
+    }
+
+    /// Strict weak order for sorting an update, valid as long as `*this` lives
+    auto comparator() const
+    {
+        return [this](int a, int b) { return contains(a, b); };
+    }
+
+    /// Whether no page of `update` has to come before one printed earlier, in a single pass
+    auto is_ordered(std::span<const int> update) const -> bool
+    {
+        std::array<std::uint64_t, max_pages / 64> seen{};
+        for (const int page : update) {
+            const auto p = static_cast<std::size_t>(page);
+            if (p >= pages) continue;
+            const auto later = successors(p);
+            for (std::size_t w = 0; w < words; ++w) {
+                if ((later[w] & seen[w]) != 0) return false;
+            }
+            seen[p / 64] |= std::uint64_t{1} << (p % 64);
+        }
+        return true;
+    }
+
+    /// The pages of `update` that appear in some rule, written into `set`
+    auto page_set(std::span<const int> update, Page_set& set) const -> void
+    {
+        set.assign(words, 0);
+        for (const int page : update) {
+            const auto p = static_cast<std::size_t>(page);
+            if (p < pages) set[p / 64] |= std::uint64_t{1} << (p % 64);
+        }
+    }
+};
+
+/// Topological ranks of the pages of an update: a page of rank r has a chain of r pages of the same update that must
+/// come before it. The ranks only depend on which pages an update holds, so they are computed once per distinct page
+/// set and afterwards cost one lookup per page.
+class Rank_table {
+    struct Page_set_hash {
+        auto operator()(const Page_set& set) const -> std::size_t
+        {
+            std::size_t hash = set.size();
+            for (const auto word : set) {
+                hash = std::rotl(hash, 5) ^ (word * 0x9e3779b97f4a7c15);
+            }
+            return hash;
+        }
+    };
+
+    const Ordering_rules* rules;
+    /// ranks of the members of a page set, in ascending page order
+    std::unordered_map<Page_set, std::vector<std::uint32_t>, Page_set_hash> cache;
+    Page_set key;
+    std::vector<std::uint32_t> rank_buffer;
+    std::vector<std::size_t> order;
+    std::vector<std::size_t> counts;
+
+    auto compute_ranks(const Page_set& set) const -> std::vector<std::uint32_t>
+    {
+        std::vector<std::size_t> members;
+        for (std::size_t w = 0; w < set.size(); ++w) {
+            for (auto bits = set[w]; bits != 0; bits &= bits - 1) {
+                members.push_back(w * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+            }
+        }
+        std::vector<std::uint32_t> in_degree;
+        for (const auto page : members) {
+            const auto before = rules->predecessors(page);
+            std::uint32_t degree = 0;
+            for (std::size_t w = 0; w < set.size(); ++w) {
+                degree += static_cast<std::uint32_t>(std::popcount(before[w] & set[w]));
+            }
+            in_degree.push_back(degree);
+        }
+        // if the in-degrees are 0..k-1 and every predecessor of a page has a lower in-degree, the rules order the pages
+        // totally and without a cycle, and the in-degrees already are the ranks. that is the case for every real update
+        std::vector<std::uint8_t> taken(members.size());
+        const bool permutation = ranges::all_of(in_degree, [&](std::uint32_t degree) {
+            return degree < members.size() && taken[degree]++ == 0;
+        });
+        const auto preceded_by_lower = [&](std::size_t i) {
+            const auto before = rules->predecessors(members[i]);
+            for (std::size_t w = 0; w < set.size(); ++w) {
+                for (auto bits = before[w] & set[w]; bits != 0; bits &= bits - 1) {
+                    const auto j = position_in(set, w * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+                    if (in_degree[j] >= in_degree[i]) return false;
+                }
+            }
+            return true;
+        };
+        if (permutation && ranges::all_of(views::iota(0uz, members.size()), preceded_by_lower)) return in_degree;
+
+        // otherwise rank by the longest chain of predecessors, peeling off pages whose predecessors are all ranked
+        std::vector<std::uint32_t> ranks(members.size(), 0);
+        std::vector<std::size_t> ready;
+        for (std::size_t i = 0; i < members.size(); ++i) {
+            if (in_degree[i] == 0) ready.push_back(i);
+        }
+        std::size_t ranked = 0;
+        while (!ready.empty()) {
+            const auto i = ready.back();
+            ready.pop_back();
+            ++ranked;
+            const auto later = rules->successors(members[i]);
+            for (std::size_t w = 0; w < set.size(); ++w) {
+                for (auto bits = later[w] & set[w]; bits != 0; bits &= bits - 1) {
+                    const auto j = position_in(set, w * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+                    ranks[j] = std::max(ranks[j], ranks[i] + 1);
+                    if (--in_degree[j] == 0) ready.push_back(j);
+                }
+            }
+        }
+        if (ranked != members.size()) throw std::invalid_argument("the ordering rules of an update contain a cycle");
+        return ranks;
+    }
+
+public:
+    explicit Rank_table(const Ordering_rules& rules) : rules{&rules} {}
+
+    /// Rank of every page of `update`, valid until the next call. Pages that appear in no rule get rank 0.
+    auto ranks(std::span<const int> update) -> std::span<const std::uint32_t>
+    {
+        rules->page_set(update, key);
+        auto found = cache.find(key);
+        if (found == cache.end()) {
+            found = cache.emplace(key, compute_ranks(key)).first;
+        }
+        const auto& set_ranks = found->second;
+        rank_buffer.clear();
+        for (const int page : update) {
+            const auto p = static_cast<std::size_t>(page);
+            rank_buffer.push_back(p < rules->page_count() ? set_ranks[position_in(key, p)] : 0);
+        }
+        return rank_buffer;
+    }
+
+    /// Writes `update` in rule order to `out` with a counting sort over the ranks
+    auto reorder(std::span<const int> update, std::span<int> out) -> void
+    {
+        const auto rank = ranks(update);
+        counts.assign(update.size() + 1, 0);
+        for (const auto r : rank) {
+            ++counts[r + 1];
+        }
+        std::partial_sum(counts.begin(), counts.end(), counts.begin());
+        for (std::size_t i = 0; i < update.size(); ++i) {
+            out[counts[rank[i]]++] = update[i];
+        }
+    }
+
+    /// The page that ends up in the middle of `update` once it is in rule order, without ordering the rest
+    auto middle_page(std::span<const int> update) -> int
+    {
+        const auto rank = ranks(update);
+        order.resize(update.size());
+        std::iota(order.begin(), order.end(), 0uz);
+        const auto middle = order.begin() + static_cast<std::ptrdiff_t>((update.size() - 1) / 2);
+        ranges::nth_element(order, middle, {}, [&](std::size_t i) { return rank[i]; });
+        return update[*middle];
+    }
+};
+
+struct Manual {
+    Ordering_rules rules;
+    utils::Jagged<int> updates;
+};
+
+auto parse(std::string_view text) -> Manual
 {
-    return [&constraints](int a, int b) { return constraints.contains(std::pair{a, b}); };
+    const auto split_at = std::min(text.find("\n\n"), text.size());
+    const auto rules_text = text.substr(0, split_at);
+    const auto updates_text = text.substr(std::min(split_at + 2, text.size())) | str::trim;
+
+    std::vector<int> pairs(rules_text.size() / 2 + 1);
+    Manual manual{Ordering_rules{str::parse_ints<int>(rules_text, pairs)}, {}};
+    manual.updates.reserve(ranges::count(updates_text, '\n') + 1, updates_text.size() / 2 + 1);
+    for (std::string_view line : updates_text | str::split('\n')) {
+        manual.updates.emplace_row(line.size() / 2 + 1, [=](std::span<int> out) {
+            return str::parse_ints<int>(line, out).size();
+        });
+    }
+    return manual;
 }
+
 auto middle_point(std::span<const int> span) -> int { return span[(span.size() - 1) / 2]; }
 
-auto puzzle1(std::string_view text) -> int
+/// Sum of the middle pages of all updates that already follow the rules
+auto sum_ordered_middles(const Manual& manual) -> int
 {
-    const auto [constraints, updates] = parse(text);
     return utils::sum(
-        updates //
-        | views::filter([&](auto r) { return std::ranges::is_sorted(r, get_sort_func(constraints)); })
+        manual.updates //
+        | views::filter([&](auto update) { return manual.rules.is_ordered(update); })
         | views::transform(middle_point)
     );
 }
 
-auto puzzle2(std::string_view text) -> int
+/// Sum of the middle pages of all updates that break the rules, after putting them in order
+auto sum_reordered_middles(const Manual& manual) -> int
 {
-    const auto [constraints, updates] = parse(text);
-    auto sort_func = get_sort_func(constraints);
-    return utils::sum(
-        updates //
-        | views::filter([&](auto r) { return !std::ranges::is_sorted(r, sort_func); })
-        | views::transform([&](std::vector<int> vec) {
-              std::ranges::sort(vec, sort_func);
-              return vec;
-          })
-        | views::transform(middle_point)
-    );
+    const auto precedes = manual.rules.comparator();
+    std::vector<int> buffer;
+    int sum = 0;
+    for (const auto update : manual.updates) {
+        if (ranges::is_sorted(update, precedes)) continue;
+        buffer.assign(update.begin(), update.end());
+        ranges::sort(buffer, precedes);
+        sum += middle_point(buffer);
+    }
+    return sum;
 }
 
+/// Same as `sum_reordered_middles`, but picks the middle page by its topological rank instead of sorting
+auto sum_ranked_middles(const Manual& manual) -> int
+{
+    Rank_table ranks{manual.rules};
+    int sum = 0;
+    for (const auto update : manual.updates) {
+        if (!manual.rules.is_ordered(update)) sum += ranks.middle_page(update);
+    }
+    return sum;
+}
+
+export struct Day5 {
+    using Parsed = Manual;
+    static auto parse(std::string_view text) -> Manual { return ::parse(text); }
+    static auto part1(const Manual& manual) -> int { return sum_ordered_middles(manual); }
+    static auto part2(const Manual& manual) -> int { return sum_ranked_middles(manual); }
+    static auto check() -> void;
+    static auto extra_phases(utils::bench::Harness& bench, std::string_view input) -> void;
+};
+
 
 constexpr std::string_view test_input = R"(47|53
 97|13
@@ -94,19 +334,22 @@ constexpr std::string_view test_input = R"(47|53
 97,13,75,29,47
 )";
 
-auto main() -> int
+auto Day5::check() -> void
+{
+    const auto test = utils::day::run<Day5>(test_input);
+    assert_eq(test.part1, 143);
+    assert_eq(test.part2, 123);
+
+    const auto manual = parse(test_input);
+    assert_eq(sum_reordered_middles(manual), 123);
+    Rank_table ranks{manual.rules};
+    std::array<int, 5> reordered{};
+    ranks.reorder(manual.updates[3], reordered);
+    assert_eq(reordered, std::array{97, 75, 47, 61, 53});
+}
+
+auto Day5::extra_phases(utils::bench::Harness& bench, std::string_view input) -> void
 {
-    assert_eq(puzzle1(test_input), 143);
-    std::println("{}", colored(Color::green, "Test for puzzle 1 passed"));
-    assert_eq(puzzle2(test_input), 123);
-    std::println("{}", colored(Color::green, "Test for puzzle 2 passed"));
-
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/5.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+    const auto manual = parse(input);
+    bench.run("sort", [&] { return sum_reordered_middles(manual); });
 }
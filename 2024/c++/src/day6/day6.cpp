@@ -1,103 +1,222 @@
+export module day6;
+
 import std;
 import utils;
 
 using namespace utils::assert;
-namespace views = std::views;
 namespace ranges = std::ranges;
-using utils::pretty::Color;
-using utils::pretty::colored;
-
-struct Vec2 {
-    std::int32_t x;
-    std::int32_t y;
-    friend auto operator+(Vec2 a, Vec2 b) -> Vec2 { return Vec2{a.x + b.x, a.y + b.y}; }
-    auto rotated90() -> Vec2 { return Vec2{-y, x}; }
-    auto operator<=>(const Vec2&) const = default;
+
+enum Heading : std::uint8_t { up, right, down, left };
+
+constexpr auto turned_right(Heading heading) -> Heading { return static_cast<Heading>((heading + 1) % 4); }
+
+struct Guard {
+    /// y * width + x
+    std::size_t cell;
+    Heading heading;
 };
 
-using Game_marix = std::mdspan<char, std::dextents<std::size_t, 2>>;
-struct Game_board {
-    std::vector<char> data;
-    Game_marix matrix;
-    Game_board(std::vector<char> board_data, std::size_t height, std::size_t width)
-        : data{std::move(board_data)}, matrix{data.data(), height, width}
+/// The lab floor together with a jump table: for every cell and heading the cell in front of the next obstacle, or
+/// the last cell before the edge. The guard then moves from turn to turn instead of from cell to cell.
+class Lab {
+public:
+    struct Jump {
+        std::uint32_t cell;
+        bool leaves;
+    };
+
+private:
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::vector<std::uint8_t> blocked;
+    std::vector<Jump> jumps;
+
+    /// Fills the jumps heading `towards` for the cells `first + k * step`, k in [0, count), where `towards` points to
+    /// lower k
+    auto fill_jumps(std::size_t first, std::ptrdiff_t step, std::size_t count, Heading towards) -> void
     {
+        const auto cell_at = [=](std::size_t k) {
+            return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(first) + static_cast<std::ptrdiff_t>(k) * step);
+        };
+        std::optional<std::size_t> obstacle;
+        for (std::size_t k = 0; k < count; ++k) {
+            const auto cell = cell_at(k);
+            const auto stop = obstacle ? cell_at(*obstacle + 1) : cell_at(0);
+            jumps[cell * 4 + towards] = Jump{static_cast<std::uint32_t>(stop), !obstacle};
+            if (blocked[cell]) obstacle = k;
+        }
+    }
+
+public:
+    explicit Lab(std::string_view text)
+    {
+        width = std::min(text.find('\n'), text.size());
+        height = (text.size() + 1) / (width + 1);
+        blocked.resize(width * height);
+        for (std::size_t y = 0; y < height; ++y) {
+            for (std::size_t x = 0; x < width; ++x) {
+                blocked[y * width + x] = text[y * (width + 1) + x] == '#';
+            }
+        }
+
+        jumps.resize(blocked.size() * 4);
+        const auto row_step = static_cast<std::ptrdiff_t>(width);
+        for (std::size_t y = 0; y < height; ++y) {
+            fill_jumps(y * width, 1, width, left);
+            fill_jumps(y * width + width - 1, -1, width, right);
+        }
+        for (std::size_t x = 0; x < width; ++x) {
+            fill_jumps(x, row_step, height, up);
+            fill_jumps((height - 1) * width + x, -row_step, height, down);
+        }
+    }
+
+    auto size() const -> std::size_t { return blocked.size(); }
+    auto is_blocked(std::size_t cell) const -> bool { return blocked[cell] != 0; }
+    auto jump(Guard guard) const -> Jump { return jumps[guard.cell * 4 + guard.heading]; }
+
+    /// The cell `steps` cells further towards `heading`
+    auto moved(std::size_t cell, Heading heading, std::ptrdiff_t steps = 1) const -> std::size_t
+    {
+        constexpr std::array<std::ptrdiff_t, 4> dx{0, 1, 0, -1};
+        constexpr std::array<std::ptrdiff_t, 4> dy{-1, 0, 1, 0};
+        const auto offset = dy[heading] * static_cast<std::ptrdiff_t>(width) + dx[heading];
+        return static_cast<std::size_t>(static_cast<std::ptrdiff_t>(cell) + steps * offset);
+    }
+
+    /// Steps from `from` to `to` when walking towards `heading`, nullopt if `to` is not ahead on the same line
+    auto steps_to(std::size_t from, std::size_t to, Heading heading) const -> std::optional<std::size_t>
+    {
+        const auto [from_y, from_x] = std::pair{from / width, from % width};
+        const auto [to_y, to_x] = std::pair{to / width, to % width};
+        switch (heading) {
+        case up: return from_x == to_x && to_y <= from_y ? std::optional{from_y - to_y} : std::nullopt;
+        case right: return from_y == to_y && to_x >= from_x ? std::optional{to_x - from_x} : std::nullopt;
+        case down: return from_x == to_x && to_y >= from_y ? std::optional{to_y - from_y} : std::nullopt;
+        case left: return from_y == to_y && to_x <= from_x ? std::optional{from_x - to_x} : std::nullopt;
+        }
+        std::unreachable();
     }
 };
-struct Guard {
-    Vec2 pos;
-    Vec2 dir;
-    auto operator<=>(const Guard&) const = default;
+
+/// The turns a guard has made, one bit per cell and heading. Only the bits that were set are cleared again, so one
+/// set can be reused for many walks without touching the whole bitset.
+class Turn_set {
+    std::vector<std::uint64_t> bits;
+    std::vector<std::size_t> marked;
+
+public:
+    explicit Turn_set(std::size_t cells) : bits((cells * 4 + 63) / 64) {}
+
+    /// Marks a turn, false if it was marked already
+    auto insert(std::size_t cell, Heading heading) -> bool
+    {
+        const auto index = cell * 4 + heading;
+        const auto mask = std::uint64_t{1} << (index % 64);
+        if ((bits[index / 64] & mask) != 0) return false;
+        bits[index / 64] |= mask;
+        marked.push_back(index / 64);
+        return true;
+    }
+
+    auto clear() -> void
+    {
+        for (const auto word : marked) {
+            bits[word] = 0;
+        }
+        marked.clear();
+    }
 };
 
-auto parse(std::string_view text) -> std::pair<Game_board, Guard>
+auto parse(std::string_view text) -> std::pair<Lab, Guard>
 {
-    auto width_newlines = text.find_first_of('\n') + 1;
-    auto height = text.size() / width_newlines;
-    auto game_board_data = text                                                          //
-                         | std::views::filter([](char c) { return c != '\n'; })          //
-                         | views::transform([](char c) { return c == '#' ? '#' : '.'; }) //
-                         | ranges::to<std::vector>();
-    auto guard_pos_newlines = text.find_first_of('^');
-    return {
-        Game_board{std::move(game_board_data), height, width_newlines - 1},
-        Guard{
-            .pos{
-                .x = static_cast<std::int32_t>(guard_pos_newlines % width_newlines),
-                .y = static_cast<std::int32_t>(guard_pos_newlines / width_newlines)
-            },
-            .dir{0, -1}
-        }
-    };
+    const auto width = std::min(text.find('\n'), text.size());
+    const auto start = text.find('^');
+    return {Lab{text}, Guard{(start / (width + 1)) * width + start % (width + 1), up}};
 }
 
-auto next_state(Game_marix matrix, Guard guard) -> std::optional<Guard>
+/// Moves the guard from turn to turn until it leaves the lab or repeats a turn, calling `on_segment(from, to, heading)`
+/// for every straight run. `extra` is an obstacle that is not part of the lab. Returns whether the guard is stuck in a
+/// loop.
+template <typename F>
+auto walk(const Lab& lab, Guard guard, std::optional<std::size_t> extra, Turn_set& turns, F on_segment) -> bool
 {
-    auto [x, y] = guard.pos + guard.dir;
-    if (x >= matrix.extent(0) || y >= matrix.extent(1)) {
-        return std::nullopt;
+    turns.clear();
+    while (true) {
+        auto [stop, leaves] = lab.jump(guard);
+        if (extra) {
+            const auto to_extra = lab.steps_to(guard.cell, *extra, guard.heading);
+            if (to_extra && *to_extra > 0 && *to_extra <= *lab.steps_to(guard.cell, stop, guard.heading)) {
+                stop = static_cast<std::uint32_t>(lab.moved(*extra, guard.heading, -1));
+                leaves = false;
+            }
+        }
+        on_segment(guard.cell, std::size_t{stop}, guard.heading);
+        if (leaves) return false;
+        if (!turns.insert(stop, guard.heading)) return true;
+        guard = Guard{stop, turned_right(guard.heading)};
     }
-    return (matrix[y, x] == '#') ? Guard{guard.pos, guard.dir.rotated90()} : Guard{.pos{x, y}, .dir{guard.dir}};
 }
-auto get_states(Game_marix matrix, Guard guard) -> std::optional<std::set<Guard>>
+
+/// Every cell on the guard's path except the start, in the order the guard first reaches them, each with the guard
+/// state one step before it gets there
+auto first_visits(const Lab& lab, Guard guard) -> std::vector<std::pair<std::size_t, Guard>>
 {
-    std::optional<Guard> next = guard;
-    std::set<Guard> states;
-    while ((next = next_state(matrix, *next))) {
-        auto [_, did_insert] = states.insert(*next);
-        if (!did_insert) {
-            return std::nullopt;
+    std::vector<std::uint8_t> visited(lab.size());
+    visited[guard.cell] = 1;
+    std::vector<std::pair<std::size_t, Guard>> visits;
+    Turn_set turns{lab.size()};
+    walk(lab, guard, std::nullopt, turns, [&](std::size_t from, std::size_t to, Heading heading) {
+        for (auto cell = from; cell != to; cell = lab.moved(cell, heading)) {
+            const auto next = lab.moved(cell, heading);
+            if (visited[next] == 0) {
+                visited[next] = 1;
+                visits.emplace_back(next, Guard{cell, heading});
+            }
         }
-    }
-    return std::move(states);
+    });
+    return visits;
 }
 
-
-auto puzzle1(std::string_view text) -> std::uint32_t
+/// Number of cells where one more obstacle traps the guard in a loop. Only cells on the original path can change the
+/// walk, and a walk only differs from the original after the first time it reaches the obstacle, so every trial
+/// starts right in front of it. Trials are independent and spread over `workers` threads in batches.
+auto count_loop_obstacles(const Lab& lab, Guard guard, std::size_t workers = utils::parallel::worker_count())
+    -> std::uint32_t
 {
-    const auto [board, guard] = parse(text);
-    auto states = *get_states(board.matrix, guard) //
-                | views::transform(&Guard::pos)    //
-                | ranges::to<std::vector>();
-    std::ranges::sort(states);
-    return ranges::distance(states | views::chunk_by(std::equal_to{}));
+    constexpr std::size_t batch_size = 256;
+    const auto candidates = first_visits(lab, guard);
+    const auto batches = (candidates.size() + batch_size - 1) / batch_size;
+    std::vector<std::uint32_t> loops(batches);
+    utils::parallel::for_each_index(
+        batches,
+        [&](std::size_t batch) {
+            Turn_set turns{lab.size()};
+            const auto first = batch * batch_size;
+            const auto trials = std::span{candidates}.subspan(first, std::min(batch_size, candidates.size() - first));
+            for (const auto& [cell, before] : trials) {
+                if (walk(lab, before, cell, turns, [](auto...) {})) ++loops[batch];
+            }
+        },
+        workers
+    );
+    return ranges::fold_left(loops, 0u, std::plus{});
 }
 
-
-auto puzzle2(std::string_view text) -> std::uint32_t
-{
-    auto [board, guard] = parse(text);
-    std::uint32_t counter = 0;
-    std::println("size: {}", board.data.size());
-    for (auto [c, i] : std::views::zip(board.data, std::views::iota(0uz))) {
-        if (i % 100 == 0) std::println("iteration: {}", i);
-        if (c == '#') continue;
-        c = '#';
-        if (!get_states(board.matrix, guard)) ++counter;
-        c = '.';
+export struct Day6 {
+    using Parsed = std::pair<Lab, Guard>;
+    static auto parse(std::string_view text) -> Parsed { return ::parse(text); }
+    static auto part1(const Parsed& parsed) -> std::uint32_t
+    {
+        return static_cast<std::uint32_t>(first_visits(parsed.first, parsed.second).size() + 1);
     }
-    return counter;
-}
+    static auto part2(const Parsed& parsed) -> std::uint32_t
+    {
+        return count_loop_obstacles(parsed.first, parsed.second);
+    }
+    static auto check() -> void;
+    static auto extra_phases(utils::bench::Harness& bench, std::string_view input) -> void;
+};
 
 
 constexpr std::string_view test_input = R"(....#.....
@@ -112,21 +231,19 @@ constexpr std::string_view test_input = R"(....#.....
 ......#...
 )";
 
-auto main() -> int
+auto Day6::check() -> void
 {
+    const auto test = utils::day::run<Day6>(test_input);
+    assert_eq(test.part1, 41);
+    assert_eq(test.part2, 6);
 
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/6.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-
-    assert_eq(puzzle1(test_input), 41);
-    std::println("{}", colored(Color::green, "Test for puzzle 1 passed"));
-    std::println("result of puzzle1 is: {}", puzzle1(input));
+    const auto [lab, guard] = parse(test_input);
+    assert_eq(count_loop_obstacles(lab, guard, 1), 6);
+}
 
-    assert_eq(puzzle2(test_input), 6);
-    std::println("{}", colored(Color::green, "Test for puzzle 2 passed"));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+auto Day6::extra_phases(utils::bench::Harness& bench, std::string_view input) -> void
+{
+    const auto [lab, guard] = parse(input);
+    bench.run("loops serial", [&] { return count_loop_obstacles(lab, guard, 1); });
+    bench.run("loops parallel", [&] { return count_loop_obstacles(lab, guard); });
 }
@@ -1,3 +1,5 @@
+export module day7;
+
 import std;
 import utils;
 
@@ -5,14 +7,17 @@ using namespace utils::assert;
 namespace views = std::views;
 namespace ranges = std::ranges;
 namespace str = utils::strings;
-using utils::pretty::Color;
-using utils::pretty::colored;
+
+/// Every row holds the expected result followed by the operands
+using Equations = utils::Jagged<std::size_t>;
 
 struct Operation {
     std::size_t result;
-    std::vector<std::size_t> operands;
+    std::span<const std::size_t> operands;
 };
-auto parse(std::string_view text) -> std::vector<Operation>
+auto to_operation(std::span<const std::size_t> row) -> Operation { return {row[0], row.subspan(1)}; }
+
+auto parse(std::string_view text) -> Equations
 {
     return text             //
          | str::trim        //
@@ -21,126 +26,112 @@ auto parse(std::string_view text) -> std::vector<Operation>
                str::split(str::match_or(": ", ' ')) //
                | views::transform(str::parse_num_value<std::size_t>)
          )
-         | views::transform([](auto r) {
-               return Operation{
-                   .result{*r.begin()}, //
-                   .operands{
-                       views::drop(r, 1) //
-                       | ranges::to<std::vector>()
-                   }
-               };
-           })
-         | ranges::to<std::vector>();
+         | utils::to_jagged<std::size_t>;
 }
 
-auto factorial(std::size_t n) -> std::size_t
-{
-    return n <= 1 ? 1 : ranges::fold_left(views::iota(1uz, n + 1), 1uz, std::multiplies{});
-}
-
-constexpr auto n_nominal_coefficient
-    = [](std::same_as<std::size_t> auto... ks) { return factorial((0 + ... + ks)) / (1 * ... * factorial(ks)); };
+/// An operator policy undoes `lhs op rhs = result`: it calls `solve(lhs)` for the left operand that gives `result`, if
+/// there is one, and returns its answer
+template <typename Op>
+concept Operator = requires(std::size_t n, bool (*solve)(std::size_t)) {
+    { Op::undo(n, n, solve) } -> std::same_as<bool>;
+};
 
-template <std::size_t I>
-    requires(I >= 1)
-auto counts(std::size_t start, std::size_t end)
-{
-    if constexpr (I == 1) {
-        return views::single(std::tuple{end - start});
-    }
-    else {
-        return views::iota(start, end + 1) | views::transform([=](std::size_t i) {
-                   return counts<I - 1>(0, end - i)
-                        | views::transform([=](auto tup) { return std::tuple_cat(std::tuple{i}, tup); });
-               })
-             | views::join;
+struct Add {
+    static constexpr auto undo(std::size_t result, std::size_t rhs, auto&& solve) -> bool
+    {
+        return result >= rhs && solve(result - rhs);
     }
-}
+};
 
-template <char... Cs>
-auto permutations(std::size_t size) -> std::vector<std::vector<char>>
-{
-    std::vector<char> vec(size);
-    constexpr auto N = sizeof...(Cs);
-    // std::println("{}", counts<N>(0, size));
-    return counts<N>(0, size) //
-         | views::transform([&vec](auto tup) {
-               auto start = 0;
-               [&, start]<std::size_t... Is>(std::index_sequence<Is...>) mutable {
-                   (..., [&](std::size_t i, char c) {
-                       std::ranges::fill_n(vec.begin() + start, i, c);
-                       start += i;
-                   }(std::get<Is>(tup), Cs));
-               }(std::make_index_sequence<N>());
-
-               return views::repeat(false, std::apply(n_nominal_coefficient, tup)) //
-                    | views::transform([&vec](bool) mutable {
-                          auto _ = ranges::next_permutation(vec);
-                          return vec;
-                      });
-           })          //
-         | views::join //
-         | ranges::to<std::vector>();
-}
+struct Mul {
+    static constexpr auto undo(std::size_t result, std::size_t rhs, auto&& solve) -> bool
+    {
+        // anything times zero is zero, so the left operand does not matter
+        if (rhs == 0) return result == 0;
+        return result % rhs == 0 && solve(result / rhs);
+    }
+};
 
-template <char... Cs>
-auto get_calibration_result(auto func, std::span<const Operation> operations)
-{
-    return utils::sum(
-        operations | views::transform([&](const Operation& op) {
-            auto results
-                = permutations<Cs...>(op.operands.size() - 1) | views::transform([&](std::span<const char> ops) {
-                      return ranges::fold_left(views::zip(ops, op.operands | views::drop(1)), op.operands[0], func);
-                  });
-
-            return ranges::any_of(
-                       results | ranges::to<std::vector>(),
-                       [result = op.result](std::size_t res) { return res == result; }
-                   )
-                     ? op.result
-                     : 0;
-        })
-    );
-}
+/// `lhs || rhs` writes the digits of `rhs` after the ones of `lhs`
+struct Concat {
+    static constexpr auto undo(std::size_t result, std::size_t rhs, auto&& solve) -> bool
+    {
+        const auto digits = str::digit_count(rhs);
+        if (digits >= str::powers_of_ten.size()) return false;
+        const auto shift = str::powers_of_ten[digits];
+        return result % shift == rhs && solve(result / shift);
+    }
+};
 
-auto puzzle1(std::string_view text) -> std::uint64_t
-{
-    return get_calibration_result<'+', '*'>(
-        [](std::size_t acc, std::pair<char, std::size_t> pair) {
-            auto [op, operand] = pair;
-            return op == '+' ? acc + operand : acc * operand;
-        },
-        parse(text)
-    );
-}
+/// A set of operators, fixed at compile time so the solver is instantiated and inlined once per set
+template <Operator... Ops>
+struct Operators {
+    /// Whether `operands`, combined left to right with any of the operators, can give `target`. Works backwards from
+    /// the target: the last operator has to be undone first, and most of them cannot be, so dead branches end right
+    /// away instead of after evaluating a whole operator string.
+    static constexpr auto is_solvable(std::size_t target, std::span<const std::size_t> operands) -> bool
+    {
+        if (operands.size() == 1) return operands[0] == target;
+        const auto rest = operands.first(operands.size() - 1);
+        const auto solve_rest = [rest](std::size_t lhs) { return is_solvable(lhs, rest); };
+        return (... || Ops::undo(target, operands.back(), solve_rest));
+    }
+};
 
-auto cat(std::size_t a, std::size_t b)
+/// Sum of the results of all equations `Ops` can solve, on `workers` threads. The cost of an equation grows with its
+/// operand count, so equations are bucketed by operand count and handed out in batches, the most expensive first:
+/// long ones start early and short ones fill the gaps at the end. Only indices are reordered, the equations stay where
+/// they are.
+template <typename Ops>
+auto get_calibration_result(const Equations& equations, std::size_t workers = utils::parallel::worker_count())
+    -> std::uint64_t
 {
-    auto digits_b = b == 0 ? 1 : static_cast<std::size_t>(std::log10(b)) + 1;
-    return a * static_cast<std::size_t>(std::pow(10, digits_b)) + b;
-}
+    constexpr std::size_t batch_size = 32;
+    if (equations.empty()) return 0;
+    const auto operand_count = [&](std::size_t i) { return equations[i].size() - 1; };
+    const auto indices = views::iota(0uz, equations.size());
+    const auto most_operands = ranges::max(indices | views::transform(operand_count));
+    std::vector<std::size_t> bucket_starts(most_operands + 2, 0);
+    for (const auto i : indices) {
+        ++bucket_starts[most_operands - operand_count(i) + 1];
+    }
+    std::partial_sum(bucket_starts.begin(), bucket_starts.end(), bucket_starts.begin());
+    std::vector<std::size_t> order(equations.size());
+    for (const auto i : indices) {
+        order[bucket_starts[most_operands - operand_count(i)]++] = i;
+    }
 
-auto puzzle2(std::string_view text) -> std::uint64_t
-{
-    std::println("{}", permutations<'a', 'b', 'c'>(2));
-    return get_calibration_result<'+', '*', '|'>(
-        [](std::size_t acc, std::pair<char, std::size_t> pair) {
-            auto [op, operand] = pair;
-            switch (op) {
-            case '+':
-                return acc + operand;
-            case '*':
-                return acc * operand;
-            case '|':
-                return cat(acc, operand);
-            default:
-                std::unreachable();
+    const auto batches = (order.size() + batch_size - 1) / batch_size;
+    std::vector<std::uint64_t> sums(batches);
+    utils::parallel::for_each_index(
+        batches,
+        [&](std::size_t batch) {
+            const auto first = batch * batch_size;
+            for (const auto i : std::span{order}.subspan(first, std::min(batch_size, order.size() - first))) {
+                const auto op = to_operation(equations[i]);
+                if (Ops::is_solvable(op.result, op.operands)) sums[batch] += op.result;
             }
         },
-        parse(text)
+        workers
     );
+    return ranges::fold_left(sums, std::uint64_t{0}, std::plus{});
 }
 
+export struct Day7 {
+    using Parsed = Equations;
+    static auto parse(std::string_view text) -> Equations { return ::parse(text); }
+    static auto part1(const Equations& equations) -> std::uint64_t
+    {
+        return get_calibration_result<Operators<Add, Mul>>(equations);
+    }
+    static auto part2(const Equations& equations) -> std::uint64_t
+    {
+        return get_calibration_result<Operators<Add, Mul, Concat>>(equations);
+    }
+    static auto check() -> void;
+    static auto extra_phases(utils::bench::Harness& bench, std::string_view input) -> void;
+};
+
 
 constexpr std::string_view test_input = R"(190: 10 19
 3267: 81 40 27
@@ -153,23 +144,17 @@ constexpr std::string_view test_input = R"(190: 10 19
 292: 11 6 16 20
 )";
 
-auto main() -> int
+auto Day7::check() -> void
 {
+    const auto test = utils::day::run<Day7>(test_input);
+    assert_eq(test.part1, 3749);
+    assert_eq(test.part2, 11387);
+    assert_eq(get_calibration_result<Operators<Add, Mul, Concat>>(parse(test_input), 1), 11387);
+}
 
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/7.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-
-#if 1
-    assert_eq(puzzle1(test_input), 3749);
-    std::println("{}", colored(Color::green, "Test for puzzle 1 passed"));
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-#endif
-
-    assert_eq(puzzle2(test_input), 11387);
-    std::println("{}", colored(Color::green, "Test for puzzle 2 passed"));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+auto Day7::extra_phases(utils::bench::Harness& bench, std::string_view input) -> void
+{
+    const auto equations = parse(input);
+    bench.run("solve serial", [&] { return get_calibration_result<Operators<Add, Mul, Concat>>(equations, 1); });
+    bench.run("solve parallel", [&] { return get_calibration_result<Operators<Add, Mul, Concat>>(equations); });
 }
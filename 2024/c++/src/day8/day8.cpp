@@ -1,104 +1,154 @@
+export module day8;
+
 import std;
 import utils;
 
 using namespace utils::assert;
 namespace views = std::views;
 namespace ranges = std::ranges;
-using utils::pretty::Color;
-using utils::pretty::colored;
-
-using Text_matrix = std::mdspan<const char, std::dextents<std::size_t, 2>, std::layout_stride>;
-using utils::Range_of;
-
-auto get_md(std::string_view text) -> Text_matrix
-{
-    std::size_t width = text.find_first_of('\n');
-    std::size_t height = text.size() / (width + 1);
-    return Text_matrix{
-        text.data(),
-        std::layout_stride::mapping{
-            std::dextents<std::size_t, 2>{height, width}, std::array<std::size_t, 2>{width + 1, 1}
-        }
-    };
-}
 
 struct Coordinate {
     std::int32_t x;
     std::int32_t y;
+    friend auto operator+(Coordinate a, Coordinate b) -> Coordinate { return Coordinate{a.x + b.x, a.y + b.y}; }
+    friend auto operator-(Coordinate a, Coordinate b) -> Coordinate { return Coordinate{a.x - b.x, a.y - b.y}; }
     auto operator<=>(const Coordinate&) const = default;
 };
 
-template <>
-struct std::formatter<Coordinate> : std::formatter<std::string_view> {
-    static constexpr auto format(Coordinate c, auto& ctx) { return std::format_to(ctx.out(), "({}, {})", c.x, c.y); }
-};
+/// The antennas of a map grouped by frequency in one buffer: the antennas of frequency `f` are
+/// `positions[offsets[f], offsets[f + 1])`, in reading order
+class Antenna_map {
+    static constexpr std::size_t n_frequencies = 128;
+    static constexpr std::size_t block_size = 64 * 64;
+
+    std::int32_t width = 0;
+    std::int32_t height = 0;
+    std::array<std::uint32_t, n_frequencies + 1> offsets{};
+    std::vector<Coordinate> positions;
+
+public:
+    /// Finds the antennas a block of 4096 bytes at a time: bit masks of the '.' and '\n' bytes are built with SIMD, so
+    /// runs of empty cells cost nothing and only the remaining bits are visited
+    explicit Antenna_map(std::string_view text)
+    {
+        const auto row_width = std::min(text.find('\n'), text.size());
+        const auto stride = row_width + 1;
+        width = static_cast<std::int32_t>(row_width);
+        height = static_cast<std::int32_t>((text.size() + 1) / stride);
+
+        std::vector<std::uint32_t> found;
+        std::array<std::uint64_t, block_size / 64> empty;
+        std::array<std::uint64_t, block_size / 64> newlines;
+        for (std::size_t first = 0; first < text.size(); first += block_size) {
+            const auto block = text.substr(first, block_size);
+            utils::simd::byte_masks(block, '.', empty);
+            utils::simd::byte_masks(block, '\n', newlines);
+            for (std::size_t w = 0; w * 64 < block.size(); ++w) {
+                const auto lanes = std::min(block.size() - w * 64, 64uz);
+                const auto valid = lanes == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << lanes) - 1;
+                for (auto bits = ~(empty[w] | newlines[w]) & valid; bits != 0; bits &= bits - 1) {
+                    const auto index = first + w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                    const auto frequency = static_cast<unsigned char>(text[index]);
+                    if (frequency >= n_frequencies) continue;
+                    found.push_back(static_cast<std::uint32_t>(index));
+                    ++offsets[frequency + 1];
+                }
+            }
+        }
 
-auto points_on_line(Coordinate a, Coordinate b, std::dextents<std::size_t, 2> ext)
-{
-    if (a.x > b.x) {
-        std::swap(a, b);
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        auto next = offsets;
+        positions.resize(found.size());
+        for (const auto index : found) {
+            const auto frequency = static_cast<unsigned char>(text[index]);
+            positions[next[frequency]++] = Coordinate{
+                static_cast<std::int32_t>(index % stride), static_cast<std::int32_t>(index / stride)
+            };
+        }
     }
-    auto delta_x = b.x - a.x;
-    auto delta_y = b.y - a.y;
-    auto gcd = std::gcd(delta_x, delta_y);
-    auto x_step = delta_x / gcd;
-    auto y_step = delta_y / gcd;
-    std::int32_t start = std::min(-(a.x / x_step), (a.y / y_step) % static_cast<std::int32_t>(ext.extent(0)));
-
-    std::int32_t end = std::min((ext.extent(0) - a.y) / y_step, (ext.extent(1) - a.x) / x_step);
-
-    return std::pair{delta_x / x_step, views::iota(start, end) | views::transform([=](std::int32_t n) {
-                                           return std::pair{n, Coordinate{a.x + n * x_step, a.y + n * y_step}};
-                                       })};
-}
 
+    auto contains(Coordinate c) const -> bool { return c.x >= 0 && c.y >= 0 && c.x < width && c.y < height; }
+    auto cell_count() const -> std::size_t
+    {
+        return static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    }
+    /// Reading order index of a cell inside the map
+    auto cell_index(Coordinate c) const -> std::size_t
+    {
+        return static_cast<std::size_t>(c.y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(c.x);
+    }
+
+    /// The antennas of one frequency
+    auto antennas(std::size_t frequency) const -> std::span<const Coordinate>
+    {
+        return std::span{positions}.subspan(offsets[frequency], offsets[frequency + 1] - offsets[frequency]);
+    }
+
+    /// The antennas of every frequency that has any
+    auto groups() const
+    {
+        return views::iota(0uz, n_frequencies) | views::transform([this](std::size_t f) { return antennas(f); })
+             | views::filter([](std::span<const Coordinate> group) { return group.size() > 1; });
+    }
+};
+
+enum class Antinodes {
+    /// the two cells in line with a pair of antennas where one is twice as far away as the other
+    twice_the_distance,
+    /// every cell in line with a pair of antennas
+    resonant_harmonics,
+};
 
-auto puzzle1(std::string_view text) -> std::uint64_t
+/// Number of distinct cells that are antinodes of some pair of equal frequency antennas. Antinodes are drawn straight
+/// into a bitset with one bit per cell, which takes care of duplicates, and counted with popcount at the end.
+template <Antinodes mode>
+auto count_antinodes(const Antenna_map& map) -> std::size_t
 {
-    std::map<char, std::vector<Coordinate>> map;
-    auto matrix = get_md(text);
-    for (std::int32_t i = 0; i < matrix.extent(0); ++i) {
-        for (std::int32_t j = 0; j < matrix.extent(1); ++j) {
-            if (char c = matrix[i, j]; map.contains(c)) {
-                map.at(c).push_back(Coordinate{i, j});
-            }
-            else {
-                map[c] = std::vector{Coordinate{i, j}};
+    std::vector<std::uint64_t> raster((map.cell_count() + 63) / 64);
+    const auto mark = [&](Coordinate c) {
+        const auto index = map.cell_index(c);
+        raster[index / 64] |= std::uint64_t{1} << (index % 64);
+    };
+    for (const auto group : map.groups()) {
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            for (std::size_t j = i + 1; j < group.size(); ++j) {
+                const auto [a, b] = std::pair{group[i], group[j]};
+                const auto delta = b - a;
+                if constexpr (mode == Antinodes::twice_the_distance) {
+                    if (map.contains(a - delta)) mark(a - delta);
+                    if (map.contains(b + delta)) mark(b + delta);
+                }
+                else {
+                    // the smallest step between grid cells on the line through both antennas
+                    const auto divisor = std::gcd(delta.x, delta.y);
+                    const Coordinate step{delta.x / divisor, delta.y / divisor};
+                    for (auto c = a; map.contains(c); c = c - step) {
+                        mark(c);
+                    }
+                    for (auto c = a + step; map.contains(c); c = c + step) {
+                        mark(c);
+                    }
+                }
             }
         }
     }
-    map.extract('.');
-    auto x = map | views::values //
-           | views::transform(([&](std::span<Coordinate> r) {
-                 return r | utils::enumerate | views::transform([=](auto tup) {
-                            auto [i, coord_a] = tup;
-                            return r | views::drop(i + 1) | views::transform([&](Coordinate coord_b) {
-                                       auto [b_index, points] = points_on_line(coord_a, coord_b, matrix.extents());
-                                       return points | views::transform([=](auto pair) -> std::optional<Coordinate> {
-                                                  auto [index, coord] = pair;
-                                                  auto dist_a = std::abs(index);
-                                                  auto dist_b = std::abs(index - b_index);
-                                                  return b_index * 2 == dist_b || dist_a == dist_b * 2
-                                                           ? std::optional{coord}
-                                                           : std::nullopt;
-                                              });
-                                   })
-                                 | views::join;
-                        })
-                      | views::join;
-             }))
-           | views::join                                             //
-           | views::filter([](auto opt) { return opt.has_value(); }) //
-           | views::transform(utils::opt_value)                      //
-           | ranges::to<std::vector>();
-    std::ranges::sort(x);
-    std::println("{}", x);
-    return std::ranges::distance(x | views::chunk_by(std::equal_to{}));
-    // return utils::sum(x);
+    const auto popcount = [](std::uint64_t word) { return static_cast<std::size_t>(std::popcount(word)); };
+    return utils::sum(raster | views::transform(popcount));
 }
 
-
-auto puzzle2(std::string_view text) -> std::uint64_t { return -1; }
+export struct Day8 {
+    using Parsed = Antenna_map;
+    static auto parse(std::string_view text) -> Antenna_map { return Antenna_map{text}; }
+    static auto part1(const Antenna_map& map) -> std::uint64_t
+    {
+        return count_antinodes<Antinodes::twice_the_distance>(map);
+    }
+    static auto part2(const Antenna_map& map) -> std::uint64_t
+    {
+        return count_antinodes<Antinodes::resonant_harmonics>(map);
+    }
+    static auto check() -> void;
+};
 
 
 constexpr std::string_view test_input = R"(............
@@ -115,22 +165,9 @@ constexpr std::string_view test_input = R"(............
 ............
 )";
 
-auto main() -> int
+auto Day8::check() -> void
 {
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/8.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-
-    assert_eq(puzzle1(test_input), 14);
-    std::println("{}", colored(Color::green, "Test for puzzle 1 passed"));
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-
-#if 0
-    assert_eq(puzzle2(test_input), 11387);
-    std::println("{}", colored(Color::green, "Test for puzzle 2 passed"));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
-#endif
+    const auto test = utils::day::run<Day8>(test_input);
+    assert_eq(test.part1, 14);
+    assert_eq(test.part2, 34);
 }
@@ -1,116 +1,163 @@
+export module day9;
+
 import std;
 import utils;
 
 using namespace utils::assert;
 namespace views = std::views;
-namespace ranges = std::ranges;
 namespace str = utils::strings;
-using utils::pretty::Color;
-using utils::pretty::colored;
-
-using Text_matrix = std::mdspan<const char, std::dextents<std::size_t, 2>, std::layout_stride>;
-using utils::Range_of;
 
-using Slot = std::optional<std::size_t>;
+/// Both parts add up checksums in 128 bits, a disk with billions of blocks overflows 64
+using Checksum = unsigned __int128;
 
-auto parse(std::string_view text) -> std::vector<Slot>
+/// `id * (offset + ... + offset + length - 1)`, the checksum of `length` blocks of file `id` starting at `offset`
+template <typename T>
+constexpr auto span_checksum(T id, T offset, T length) -> T
 {
-    //
-    auto sizes = text                                                    //
-               | str::trim                                               //
-               | views::transform([](char c) { return std::string{c}; }) //
-               | views::transform(str::parse_num<std::size_t>)           //
-               | views::transform(utils::opt_value);
-    auto ids = views::iota(0uz)
-             | views::transform([](std::size_t i) { return (i % 2 == 1) ? std::nullopt : std::optional{i / 2}; });
-    return views::zip(sizes, ids)
-         | views::transform([](auto pair) { return views::repeat(pair.second, pair.first); }) //
-         | views::join                                                                        //
-         | ranges::to<std::vector>();
+    return id * (length * offset + length * (length - 1) / 2);
 }
 
-
-auto compact(std::span<Slot> slots)
+/// Checksum after moving single blocks from the end of the disk into the leftmost free blocks. Two cursors walk the
+/// disk map from both ends: every file digit on the left and every gap filled from the right becomes one run of
+/// blocks whose checksum is added in closed form, so no block is ever materialised. O(1) memory and one pass over the
+/// map.
+auto checksum_compacted_blocks(std::string_view disk_map) -> Checksum
 {
-    auto iter = slots.begin();
-    const auto end = slots.end();
-    for (Slot& slot : slots | views::reverse) {
-        if (!slot) continue;
-        for (; iter < end; ++iter) {
-            auto& free = *iter;
-            if (&free >= &slot) return;
-            if (free) continue;
-            free.swap(slot);
-            break;
+    using U = Checksum;
+    if (disk_map.empty()) return 0;
+    const auto digit = [&](std::size_t i) -> U { return static_cast<U>(disk_map[i] - '0'); };
+
+    U sum = 0;
+    U position = 0;
+    const auto emit = [&](std::size_t index, U length) {
+        sum += span_checksum(static_cast<U>(index / 2), position, length);
+        position += length;
+    };
+
+    // the file the right cursor takes blocks from, and how many of them are still unmoved
+    std::size_t right = (disk_map.size() - 1) / 2 * 2;
+    U unmoved = digit(right);
+    for (std::size_t left = 0; left < right; ++left) {
+        if (left % 2 == 0) {
+            emit(left, digit(left));
+            continue;
+        }
+        for (U gap = digit(left); gap > 0 && left < right;) {
+            const auto moved = std::min(gap, unmoved);
+            emit(right, moved);
+            gap -= moved;
+            unmoved -= moved;
+            if (unmoved == 0) {
+                right -= 2;
+                // the left cursor has already passed a file right in front of this gap
+                unmoved = right > left ? digit(right) : 0;
+            }
         }
     }
+    // the rightmost file that still has blocks left stays where it is, after everything moved in front of it
+    emit(right, unmoved);
+    return sum;
 }
 
-auto checksum(utils::Range_of<Slot> auto&& slots) -> std::uint64_t
-{
-    return utils::sum(slots | utils::enumerate | views::transform([](auto pair) {
-                          auto [pos, id] = pair;
-                          return pos * id.value_or(0);
-                      }));
-}
-auto puzzle1(std::string_view text) -> std::uint64_t
-{
-    auto slots = parse(text);
-    compact(slots);
-    return checksum(slots);
-}
+/// A file as a run of blocks, the disk map of a whole disk needs one of these per file instead of one slot per block
+struct File_span {
+    std::uint64_t offset;
+    std::uint32_t length;
+    std::uint32_t id;
+};
+
+/// Free blocks between files, indexed by their size: `by_size[n]` is a min-heap of the offsets of all gaps of exactly
+/// `n` blocks. A digit of the disk map is at most 9, and gaps only shrink.
+class Free_gaps {
+    static constexpr std::size_t max_size = 9;
+    using Heap = std::priority_queue<std::uint64_t, std::vector<std::uint64_t>, std::greater<>>;
+    std::array<Heap, max_size + 1> by_size;
+
+public:
+    auto add(std::uint64_t offset, std::size_t size) -> void
+    {
+        if (size > 0) by_size[size].push(offset);
+    }
 
-auto compact2(std::span<std::pair<std::size_t, Slot>> chunks)
+    /// Takes `length` blocks from the leftmost gap that has room for them and starts before `limit`, returns the
+    /// offset they were taken from
+    auto take(std::size_t length, std::uint64_t limit) -> std::optional<std::uint64_t>
+    {
+        std::size_t best = 0;
+        for (auto size = length; size <= max_size; ++size) {
+            if (!by_size[size].empty() && (best == 0 || by_size[size].top() < by_size[best].top())) best = size;
+        }
+        if (best == 0 || by_size[best].top() >= limit) return std::nullopt;
+        const auto offset = by_size[best].top();
+        by_size[best].pop();
+        add(offset + length, best - length);
+        return offset;
+    }
+};
+
+struct Disk {
+    std::vector<File_span> files;
+    Free_gaps gaps;
+};
+
+auto parse(std::string_view text) -> Disk
 {
-    for (auto& slot : chunks | views::reverse) {
-        if (!slot.second) continue;
-        for (auto& swap : ranges::subrange{chunks.data(), &slot}) {
-            if (!swap.second && swap.first <= slot.first) {
-            }
+    Disk disk;
+    std::uint64_t offset = 0;
+    for (const auto [i, c] : text | str::trim | utils::enumerate) {
+        const auto length = static_cast<std::uint32_t>(c - '0');
+        if (i % 2 == 0) {
+            disk.files.push_back(File_span{offset, length, static_cast<std::uint32_t>(i / 2)});
+        }
+        else {
+            disk.gaps.add(offset, length);
         }
+        offset += length;
     }
+    return disk;
 }
 
-using Chunk = std::pair<std::size_t, Slot>;
+/// Moves every file once, highest id first, into the leftmost gap before it that can hold all of it. Each move costs
+/// a look at the top of the nine gap heaps and one pop and push, so compaction takes O(n log n) for n files.
+auto compact_files(Disk& disk) -> void
+{
+    for (auto& file : disk.files | views::reverse) {
+        if (const auto offset = disk.gaps.take(file.length, file.offset)) file.offset = *offset;
+    }
+}
 
-auto puzzle2(std::string_view text) -> std::uint64_t
+/// Sum of position times id over all blocks, for each file `id * (offset + ... + offset + length - 1)`
+auto checksum(std::span<const File_span> files) -> Checksum
 {
-    auto slots = parse(text);
-    auto chunks = slots //
-                | views::chunk_by(std::equal_to{})
-                | views::transform([](auto chunk) -> Chunk { return {ranges::distance(chunk), *chunk.begin()}; })
-                | ranges::to<std::vector>();
-
-    compact2(chunks);
-    std::println("{}", chunks | views::transform([](auto pair) {
-                           return views::repeat(pair.second, pair.first)
-                                | views::transform([](auto e) { return e ? std::format("{}", e.value()) : "."; });
-                       }) | views::join);
-    return checksum(
-        chunks                                                                               //
-        | views::transform([](auto pair) { return views::repeat(pair.second, pair.first); }) //
-        | views::join                                                                        //
-    );
+    return utils::sum(files | views::transform([](const File_span& file) -> Checksum {
+                          return span_checksum<Checksum>(file.id, file.offset, file.length);
+                      }));
 }
 
+export struct Day9 {
+    /// Block compaction reads the disk map itself, whole file compaction works on a copy of the spans
+    struct Parsed {
+        std::string_view disk_map;
+        Disk disk;
+    };
+    static auto parse(std::string_view text) -> Parsed { return Parsed{text | str::trim, ::parse(text)}; }
+    static auto part1(const Parsed& parsed) -> Checksum { return checksum_compacted_blocks(parsed.disk_map); }
+    static auto part2(const Parsed& parsed) -> Checksum
+    {
+        auto disk = parsed.disk;
+        compact_files(disk);
+        return checksum(disk.files);
+    }
+    static auto check() -> void;
+};
+
 
 constexpr std::string_view test_input = R"(2333133121414131402
 )";
 
-auto main() -> int
+auto Day9::check() -> void
 {
-    const std::string input = [] {
-        std::ostringstream stream;
-        std::ifstream file("../inputs/9.txt");
-        stream << file.rdbuf();
-        return std::move(stream).str();
-    }();
-
-    assert_eq(puzzle1(test_input), 1928);
-    std::println("{}", colored(Color::green, "Test for puzzle 1 passed"));
-    std::println("result of puzzle1 is: {}", puzzle1(input));
-
-    assert_eq(puzzle2(test_input), 2858);
-    std::println("{}", colored(Color::green, "Test for puzzle 2 passed"));
-    std::println("result of puzzle2 is: {}", puzzle2(input));
+    const auto test = utils::day::run<Day9>(test_input);
+    assert_eq(test.part1, 1928);
+    assert_eq(test.part2, 2858);
 }
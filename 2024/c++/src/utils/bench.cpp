@@ -0,0 +1,165 @@
+export module utils:bench;
+
+import std;
+import :pretty;
+import :strings;
+
+export namespace utils::bench {
+using namespace pretty;
+
+using Duration = std::chrono::nanoseconds;
+
+/// Keeps the compiler from discarding a value that is computed only to be timed
+template <typename T>
+auto do_not_optimize(const T& value) -> void
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Options {
+    std::size_t repeats = 20;
+    std::optional<std::filesystem::path> json;
+
+    /// Consumes `--bench <repeats>` and `--json <path>` from the command line, leaving the remaining arguments in
+    /// place. Returns nullopt if benchmarking was not requested.
+    static auto from_args(int& argc, char** argv) -> std::optional<Options>
+    {
+        std::optional<Options> options;
+        auto next_value = [&](int& i) -> std::string_view {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(std::format("missing value for '{}'", argv[i]));
+            }
+            return argv[++i];
+        };
+
+        int kept = 1;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--bench") {
+                const auto value = next_value(i);
+                const auto repeats = strings::parse_num<std::size_t>(value);
+                if (!repeats || *repeats == 0) {
+                    throw std::invalid_argument(std::format("invalid repeat count '{}'", value));
+                }
+                if (!options) options.emplace();
+                options->repeats = *repeats;
+            }
+            else if (arg == "--json") {
+                const auto value = next_value(i);
+                if (!options) options.emplace();
+                options->json = std::filesystem::path{value};
+            }
+            else {
+                argv[kept++] = argv[i];
+            }
+        }
+        argc = kept;
+        return options;
+    }
+};
+
+struct Stats {
+    std::string name;
+    std::size_t runs;
+    Duration min;
+    Duration median;
+    Duration p99;
+    /// input bytes per second of median time, in MB/s
+    double throughput;
+};
+
+auto summarize(std::string name, std::vector<Duration> samples, std::size_t bytes) -> Stats
+{
+    std::ranges::sort(samples);
+    const auto nth = [&](double quantile) {
+        const auto rank = static_cast<std::size_t>(std::ceil(quantile * static_cast<double>(samples.size())));
+        return samples[std::clamp(rank, 1uz, samples.size()) - 1];
+    };
+    const auto median = nth(0.5);
+    const auto seconds = std::chrono::duration<double>(median).count();
+    return Stats{
+        .name = std::move(name),
+        .runs = samples.size(),
+        .min = samples.front(),
+        .median = median,
+        .p99 = nth(0.99),
+        .throughput = seconds > 0 ? static_cast<double>(bytes) / 1e6 / seconds : 0.0,
+    };
+}
+
+/// Times the phases of one day against its input and reports them
+class Harness {
+    std::string day;
+    std::size_t input_bytes;
+    Options options;
+    std::vector<Stats> results;
+
+public:
+    Harness(std::string day, std::string_view input, Options options)
+        : day{std::move(day)}, input_bytes{input.size()}, options{std::move(options)}
+    {
+    }
+
+    /// Runs `phase` once to warm up, then `options.repeats` timed times
+    auto run(std::string name, std::invocable auto phase) -> void
+    {
+        using Clock = std::chrono::steady_clock;
+        do_not_optimize(phase());
+
+        std::vector<Duration> samples;
+        samples.reserve(options.repeats);
+        for (std::size_t i = 0; i < options.repeats; ++i) {
+            const auto start = Clock::now();
+            do_not_optimize(phase());
+            samples.push_back(std::chrono::duration_cast<Duration>(Clock::now() - start));
+        }
+        results.push_back(summarize(std::move(name), std::move(samples), input_bytes));
+    }
+
+    auto to_json() const -> std::string
+    {
+        std::string phases;
+        for (const Stats& stats : results) {
+            if (!phases.empty()) phases += ", ";
+            std::format_to(
+                std::back_inserter(phases),
+                R"({{"name": "{}", "runs": {}, "min_ns": {}, "median_ns": {}, "p99_ns": {}, "mb_per_s": {:.3f}}})",
+                stats.name,
+                stats.runs,
+                stats.min.count(),
+                stats.median.count(),
+                stats.p99.count(),
+                stats.throughput
+            );
+        }
+        return std::format(R"({{"day": "{}", "input_bytes": {}, "phases": [{}]}})", day, input_bytes, phases);
+    }
+
+    /// Prints a summary table and writes the json report if one was requested. Returns the exit code for main.
+    auto report() const -> int
+    {
+        std::println("{} ({} bytes, {} runs)", bold(day), input_bytes, options.repeats);
+        for (const Stats& stats : results) {
+            std::println(
+                "  {} min {:>12}  median {:>12}  p99 {:>12}  {:>10.2f} MB/s",
+                colored(Color::cyan, std::format("{:<10}", stats.name)),
+                stats.min,
+                stats.median,
+                stats.p99,
+                stats.throughput
+            );
+        }
+        if (options.json) {
+            std::ofstream file{*options.json};
+            file << to_json() << '\n';
+            if (!file) {
+                const auto msg = std::format("cannot write '{}'", options.json->string());
+                std::println(std::cerr, "{}", colored(Color::red, msg));
+                return 1;
+            }
+        }
+        return 0;
+    }
+};
+
+} // namespace utils::bench
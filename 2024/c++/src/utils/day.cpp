@@ -0,0 +1,207 @@
+export module utils:day;
+
+import std;
+import :bench;
+import :pretty;
+
+export namespace utils::day {
+using namespace pretty;
+
+/// A puzzle of one day. `parse` reads the input once, both parts only look at the parsed result, so they can share it
+/// and run at the same time.
+template <typename D>
+concept Day = requires(std::string_view input, const typename D::Parsed& parsed) {
+    { D::parse(input) } -> std::same_as<typename D::Parsed>;
+    { D::part1(parsed) } -> std::formattable<char>;
+    { D::part2(parsed) } -> std::formattable<char>;
+};
+
+template <Day D>
+using Answer1 = std::remove_cvref_t<decltype(D::part1(std::declval<const typename D::Parsed&>()))>;
+
+template <Day D>
+using Answer2 = std::remove_cvref_t<decltype(D::part2(std::declval<const typename D::Parsed&>()))>;
+
+enum class Schedule { sequential, concurrent };
+enum class Parts { both, first, second };
+
+struct Timings {
+    bench::Duration parse;
+    bench::Duration part1;
+    bench::Duration part2;
+    /// parse to last answer, less than the sum of the phases if the parts ran concurrently
+    bench::Duration total;
+};
+
+template <Day D>
+struct Result {
+    Answer1<D> part1;
+    Answer2<D> part2;
+    Timings timings;
+};
+
+/// Calls `phase` and stores how long it took in `elapsed`
+template <std::invocable F>
+auto timed(F phase, bench::Duration& elapsed) -> std::invoke_result_t<F>
+{
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto value = phase();
+    elapsed = std::chrono::duration_cast<bench::Duration>(Clock::now() - start);
+    return value;
+}
+
+/// Solves the selected parts on `parsed`. With `Schedule::concurrent` part 2 runs on its own thread next to part 1,
+/// exceptions of either part are passed on to the caller.
+template <Day D>
+auto solve_parts(const typename D::Parsed& parsed, Parts parts, Schedule schedule, Timings& timings)
+    -> std::pair<std::optional<Answer1<D>>, std::optional<Answer2<D>>>
+{
+    const auto part1 = [&] { return timed([&] { return D::part1(parsed); }, timings.part1); };
+    const auto part2 = [&] { return timed([&] { return D::part2(parsed); }, timings.part2); };
+    switch (parts) {
+    case Parts::first:
+        return {part1(), std::nullopt};
+    case Parts::second:
+        return {std::nullopt, part2()};
+    case Parts::both:
+        break;
+    }
+    if (schedule == Schedule::concurrent) {
+        auto second = std::async(std::launch::async, part2);
+        auto first = part1();
+        return {std::move(first), second.get()};
+    }
+    auto first = part1();
+    return {std::move(first), part2()};
+}
+
+/// Parses `input` once and solves both parts on the result
+template <Day D>
+auto run(std::string_view input, Schedule schedule = Schedule::sequential) -> Result<D>
+{
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    Timings timings{};
+    const typename D::Parsed parsed = timed([&] { return D::parse(input); }, timings.parse);
+    auto [part1, part2] = solve_parts<D>(parsed, Parts::both, schedule, timings);
+    timings.total = std::chrono::duration_cast<bench::Duration>(Clock::now() - start);
+    return Result<D>{std::move(*part1), std::move(*part2), timings};
+}
+
+struct Run_options {
+    Parts parts = Parts::both;
+    Schedule schedule = Schedule::concurrent;
+    std::size_t repeats = 1;
+};
+
+/// The answers of one day as text, with the timings of every repetition
+struct Report {
+    std::optional<std::string> part1;
+    std::optional<std::string> part2;
+    std::vector<Timings> runs;
+};
+
+/// Runs `D` `options.repeats` times, each time parsing anew with `parse`
+template <Day D, std::invocable Parse>
+auto report(Parse parse, const Run_options& options) -> Report
+{
+    using Clock = std::chrono::steady_clock;
+    Report report;
+    for (std::size_t i = 0; i < options.repeats; ++i) {
+        const auto start = Clock::now();
+        Timings timings{};
+        const typename D::Parsed parsed = timed(parse, timings.parse);
+        const auto [part1, part2] = solve_parts<D>(parsed, options.parts, options.schedule, timings);
+        timings.total = std::chrono::duration_cast<bench::Duration>(Clock::now() - start);
+        report.runs.push_back(timings);
+        if (part1) report.part1 = std::format("{}", *part1);
+        if (part2) report.part2 = std::format("{}", *part2);
+    }
+    return report;
+}
+
+/// The answers followed by one line per phase, with the median and the fastest of all repetitions
+auto format_report(int day, const Report& report) -> std::string
+{
+    std::string text = std::format("{}\n", bold(std::format("day {}", day)));
+    if (report.part1) std::format_to(std::back_inserter(text), "  result of puzzle1 is: {}\n", *report.part1);
+    if (report.part2) std::format_to(std::back_inserter(text), "  result of puzzle2 is: {}\n", *report.part2);
+
+    const auto phase = [&](std::string_view name, bench::Duration Timings::* member) {
+        std::vector<bench::Duration> samples;
+        for (const Timings& timings : report.runs) {
+            samples.push_back(timings.*member);
+        }
+        if (samples.empty()) return;
+        std::ranges::sort(samples);
+        const auto ms = [](bench::Duration elapsed) {
+            return std::chrono::duration<double, std::milli>(elapsed).count();
+        };
+        const auto line = std::format(
+            "  {:<6} median {:>10.3f} ms  min {:>10.3f} ms", name, ms(samples[(samples.size() - 1) / 2]), ms(samples[0])
+        );
+        std::format_to(std::back_inserter(text), "{}\n", colored(Color::cyan, line));
+    };
+    phase("parse", &Timings::parse);
+    if (report.part1) phase("part1", &Timings::part1);
+    if (report.part2) phase("part2", &Timings::part2);
+    phase("total", &Timings::total);
+    return text;
+}
+
+/// Adds the parse and both part phases of `D` to `bench`, the parts are timed on one shared parse
+template <Day D>
+auto bench_phases(bench::Harness& bench, std::string_view input) -> void
+{
+    bench.run("parse", [&] { return D::parse(input); });
+    const typename D::Parsed parsed = D::parse(input);
+    bench.run("part1", [&] { return D::part1(parsed); });
+    bench.run("part2", [&] { return D::part2(parsed); });
+}
+
+/// A day as the runner sees it. The puzzle type is erased, so that all days fit into one table.
+struct Entry {
+    int number;
+    /// checks the examples of the puzzle text, traps on a wrong answer
+    auto (*check)() -> void;
+    auto (*solve)(std::string_view input, const Run_options& options) -> Report;
+    /// solves from a file read block by block, nullptr if the day needs all of its input at once
+    auto (*solve_stream)(const std::filesystem::path& path, const Run_options& options) -> Report;
+    auto (*bench)(bench::Harness& bench, std::string_view input) -> void;
+};
+
+/// Registers `D` as day `number`. Optional static members of `D` are picked up: `check()` for the examples,
+/// `parse_stream(path)` to parse inputs larger than memory, and `extra_phases(bench, input)` for benchmarks beyond
+/// parse and the two parts.
+template <Day D>
+constexpr auto entry(int number) -> Entry
+{
+    Entry entry{
+        .number = number,
+        .check =
+            [] {
+                if constexpr (requires { D::check(); }) D::check();
+            },
+        .solve =
+            [](std::string_view input, const Run_options& options) {
+                return report<D>([&] { return D::parse(input); }, options);
+            },
+        .solve_stream = nullptr,
+        .bench =
+            [](bench::Harness& bench, std::string_view input) {
+                bench_phases<D>(bench, input);
+                if constexpr (requires { D::extra_phases(bench, input); }) D::extra_phases(bench, input);
+            },
+    };
+    if constexpr (requires(const std::filesystem::path& path) {
+                      { D::parse_stream(path) } -> std::same_as<typename D::Parsed>;
+                  }) {
+        entry.solve_stream = [](const std::filesystem::path& path, const Run_options& options) {
+            return report<D>([&] { return D::parse_stream(path); }, options);
+        };
+    }
+    return entry;
+}
+
+} // namespace utils::day
@@ -0,0 +1,436 @@
+export module utils:grid;
+
+import std;
+import :parallel;
+
+namespace utils::grid {
+
+/// Aho–Corasick automaton over bytes. Bytes that occur in no pattern share one symbol class, so the transition table
+/// has a column per distinct pattern byte plus one instead of 256.
+class Automaton {
+    std::array<std::uint8_t, 256> classes{};
+    std::size_t n_classes = 1;
+    /// `next[state * n_classes + class]`, complete so scanning never follows failure links
+    std::vector<std::uint32_t> next;
+    /// patterns ending in each state, the ones reached through failure links included
+    std::vector<std::uint32_t> match_offsets{0};
+    std::vector<std::uint32_t> matches;
+    std::vector<std::size_t> lengths;
+
+public:
+    using State = std::uint32_t;
+    static constexpr State start = 0;
+    static constexpr State missing = std::numeric_limits<State>::max();
+
+    Automaton() = default;
+
+    explicit Automaton(std::span<const std::string_view> patterns)
+    {
+        for (const auto pattern : patterns) {
+            if (pattern.empty()) throw std::invalid_argument("cannot search for an empty pattern");
+            for (const char c : pattern) {
+                auto& symbol = classes[static_cast<std::uint8_t>(c)];
+                if (symbol == 0) symbol = static_cast<std::uint8_t>(n_classes++);
+            }
+            lengths.push_back(pattern.size());
+        }
+
+        // trie
+        std::vector<std::vector<std::uint32_t>> own_matches(1);
+        next.assign(n_classes, missing);
+        for (std::uint32_t id = 0; id < patterns.size(); ++id) {
+            State state = start;
+            for (const char c : patterns[id]) {
+                const auto edge = state * n_classes + symbol(c);
+                if (next[edge] == missing) {
+                    next[edge] = static_cast<State>(own_matches.size());
+                    own_matches.emplace_back();
+                    next.resize(next.size() + n_classes, missing);
+                }
+                state = next[edge];
+            }
+            own_matches[state].push_back(id);
+        }
+
+        // failure links in breadth first order, filling in the missing transitions on the way
+        const auto n_states = own_matches.size();
+        std::vector<State> fail(n_states, start);
+        std::vector<State> queue;
+        queue.reserve(n_states);
+        for (std::size_t c = 0; c < n_classes; ++c) {
+            auto& target = next[c];
+            if (target == missing) {
+                target = start;
+            }
+            else {
+                queue.push_back(target);
+            }
+        }
+        for (std::size_t head = 0; head < queue.size(); ++head) {
+            const auto state = queue[head];
+            std::ranges::copy(own_matches[fail[state]], std::back_inserter(own_matches[state]));
+            for (std::size_t c = 0; c < n_classes; ++c) {
+                auto& target = next[state * n_classes + c];
+                const auto fallback = next[fail[state] * n_classes + c];
+                if (target == missing) {
+                    target = fallback;
+                }
+                else {
+                    fail[target] = fallback;
+                    queue.push_back(target);
+                }
+            }
+        }
+
+        for (const auto& ids : own_matches) {
+            matches.insert(matches.end(), ids.begin(), ids.end());
+            match_offsets.push_back(static_cast<std::uint32_t>(matches.size()));
+        }
+    }
+
+    auto symbol(char c) const -> std::size_t { return classes[static_cast<std::uint8_t>(c)]; }
+    auto advance(State state, char c) const -> State { return next[state * n_classes + symbol(c)]; }
+
+    /// Patterns that end at the last byte fed to reach `state`
+    auto matches_at(State state) const -> std::span<const std::uint32_t>
+    {
+        return std::span{matches}.subspan(match_offsets[state], match_offsets[state + 1] - match_offsets[state]);
+    }
+    auto match_count(State state) const -> std::size_t { return match_offsets[state + 1] - match_offsets[state]; }
+
+    auto pattern_length(std::size_t pattern) const -> std::size_t { return lengths[pattern]; }
+};
+
+} // namespace utils::grid
+
+export namespace utils::grid {
+
+/// A read-only character grid indexed `[y, x]`. Rows do not have to be adjacent, e.g. the lines of a text input are
+/// separated by their '\n'.
+using Grid_view = std::mdspan<const char, std::dextents<std::size_t, 2>, std::layout_stride>;
+
+/// Views newline separated lines of equal length as a grid, the last newline is optional
+auto from_text(std::string_view text) -> Grid_view
+{
+    const auto width = std::min(text.find('\n'), text.size());
+    const auto height = width == 0 ? 0 : (text.size() + 1) / (width + 1);
+    const std::array strides{width + 1, 1uz};
+    return Grid_view{text.data(), std::layout_stride::mapping{std::dextents<std::size_t, 2>{height, width}, strides}};
+}
+
+/// The directions lines are read in. Reading backwards is covered by searching for reversed patterns.
+enum class Direction : std::uint8_t { east, south, south_east, south_west };
+
+inline constexpr std::array all_directions{
+    Direction::east, Direction::south, Direction::south_east, Direction::south_west
+};
+
+struct Match {
+    /// index into the patterns the search was built from
+    std::size_t pattern;
+    /// first cell of the match, or top left corner for stencils
+    std::size_t y;
+    std::size_t x;
+    /// always east for stencils
+    Direction direction;
+
+    auto operator==(const Match&) const -> bool = default;
+};
+
+/// Lines in `direction` are handed out to threads in stripes of this many adjacent lines
+inline constexpr std::size_t stripe_lines = 64;
+
+} // namespace utils::grid
+
+namespace utils::grid {
+
+struct Step {
+    std::ptrdiff_t dy;
+    std::ptrdiff_t dx;
+};
+
+constexpr auto step(Direction direction) -> Step
+{
+    switch (direction) {
+    case Direction::east: return {0, 1};
+    case Direction::south: return {1, 0};
+    case Direction::south_east: return {1, 1};
+    case Direction::south_west: return {1, -1};
+    }
+    std::unreachable();
+}
+
+/// A maximal run of cells in one direction
+struct Line {
+    std::size_t y;
+    std::size_t x;
+    std::size_t length;
+};
+
+auto line_count(Grid_view grid, Direction direction) -> std::size_t
+{
+    const auto height = grid.extent(0);
+    const auto width = grid.extent(1);
+    if (height == 0 || width == 0) return 0;
+    switch (direction) {
+    case Direction::east: return height;
+    case Direction::south: return width;
+    case Direction::south_east:
+    case Direction::south_west: return height + width - 1;
+    }
+    std::unreachable();
+}
+
+/// Line `i` of `direction`, diagonals are numbered along the left (south east) or top (south west) edge first
+auto line(Grid_view grid, Direction direction, std::size_t i) -> Line
+{
+    const auto height = grid.extent(0);
+    const auto width = grid.extent(1);
+    switch (direction) {
+    case Direction::east: return {i, 0, width};
+    case Direction::south: return {0, i, height};
+    case Direction::south_east:
+        if (i < height) return {height - 1 - i, 0, std::min(i + 1, width)};
+        return {0, i - height + 1, std::min(height, width - (i - height + 1))};
+    case Direction::south_west:
+        if (i < width) return {0, i, std::min(i + 1, height)};
+        return {i - width + 1, width - 1, std::min(height - (i - width + 1), width)};
+    }
+    std::unreachable();
+}
+
+/// Feeds the cells of `line` through `automaton`, calling `on_match(state, k)` after the k-th cell whenever a
+/// pattern ends there
+template <typename F>
+auto scan_line(const Automaton& automaton, Grid_view grid, Direction direction, Line line, F on_match) -> void
+{
+    const auto [dy, dx] = step(direction);
+    const auto offset
+        = dy * static_cast<std::ptrdiff_t>(grid.stride(0)) + dx * static_cast<std::ptrdiff_t>(grid.stride(1));
+    const char* cell = grid.data_handle() + line.y * grid.stride(0) + line.x * grid.stride(1);
+    auto state = Automaton::start;
+    for (std::size_t k = 0; k < line.length; ++k, cell += offset) {
+        state = automaton.advance(state, *cell);
+        if (automaton.match_count(state) != 0) on_match(state, k);
+    }
+}
+
+/// Splits the lines of every direction into stripes and returns `scan(direction, first_line, last_line)` for each
+/// stripe, in direction then line order
+template <typename F>
+auto map_stripes(Grid_view grid, std::span<const Direction> directions, std::size_t workers, F scan)
+{
+    struct Stripe {
+        Direction direction;
+        std::size_t first;
+        std::size_t last;
+    };
+    std::vector<Stripe> stripes;
+    for (const auto direction : directions) {
+        const auto lines = line_count(grid, direction);
+        for (std::size_t first = 0; first < lines; first += stripe_lines) {
+            stripes.push_back({direction, first, std::min(first + stripe_lines, lines)});
+        }
+    }
+
+    using Result = std::invoke_result_t<F&, Direction, std::size_t, std::size_t>;
+    std::vector<Result> results(stripes.size());
+    parallel::for_each_index(
+        stripes.size(),
+        [&](std::size_t i) { results[i] = scan(stripes[i].direction, stripes[i].first, stripes[i].last); },
+        workers
+    );
+    return results;
+}
+
+template <typename T>
+auto concat(std::vector<std::vector<T>> parts) -> std::vector<T>
+{
+    std::vector<T> all;
+    for (auto& part : parts) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    return all;
+}
+
+} // namespace utils::grid
+
+export namespace utils::grid {
+
+/// Searches a grid for a set of words along rows, columns and diagonals in a single pass per line. Every direction is
+/// read one way only, add the reversed words to find them backwards as well.
+class Word_search {
+    Automaton automaton;
+
+    auto match(Direction direction, Line line, Automaton::State state, std::size_t k) const
+    {
+        const auto [dy, dx] = step(direction);
+        return std::views::transform(automaton.matches_at(state), [=, this](std::uint32_t pattern) {
+            const auto back = static_cast<std::ptrdiff_t>(k + 1 - automaton.pattern_length(pattern));
+            return Match{
+                pattern,
+                static_cast<std::size_t>(static_cast<std::ptrdiff_t>(line.y) + back * dy),
+                static_cast<std::size_t>(static_cast<std::ptrdiff_t>(line.x) + back * dx),
+                direction,
+            };
+        });
+    }
+
+public:
+    explicit Word_search(std::span<const std::string_view> words) : automaton{words} {}
+    Word_search(std::initializer_list<std::string_view> words) : automaton{std::span{words.begin(), words.size()}} {}
+
+    /// Number of occurrences of all words in `directions`
+    auto count(
+        Grid_view grid, std::span<const Direction> directions = all_directions,
+        std::size_t workers = parallel::worker_count()
+    ) const -> std::size_t
+    {
+        const auto counts = map_stripes(grid, directions, workers, [&](Direction direction, auto first, auto last) {
+            std::size_t count = 0;
+            for (auto i = first; i < last; ++i) {
+                scan_line(automaton, grid, direction, line(grid, direction, i), [&](auto state, auto) {
+                    count += automaton.match_count(state);
+                });
+            }
+            return count;
+        });
+        return std::ranges::fold_left(counts, 0uz, std::plus{});
+    }
+
+    /// All occurrences, ordered by direction and then by line
+    auto find_all(
+        Grid_view grid, std::span<const Direction> directions = all_directions,
+        std::size_t workers = parallel::worker_count()
+    ) const -> std::vector<Match>
+    {
+        return concat(map_stripes(grid, directions, workers, [&](Direction direction, auto first, auto last) {
+            std::vector<Match> found;
+            for (auto i = first; i < last; ++i) {
+                const auto current = line(grid, direction, i);
+                scan_line(automaton, grid, direction, current, [&](auto state, auto k) {
+                    std::ranges::copy(match(direction, current, state, k), std::back_inserter(found));
+                });
+            }
+            return found;
+        }));
+    }
+};
+
+/// Searches a grid for rectangular 2D patterns, given as newline separated rows in which `wildcard` matches any
+/// character. The longest wildcard free run of each stencil is found with one automaton over all rows, the remaining
+/// cells are only compared where that run occurs.
+class Stencil_search {
+    struct Cell {
+        std::size_t y;
+        std::size_t x;
+        char c;
+    };
+    struct Stencil {
+        std::size_t height = 0;
+        std::size_t width = 0;
+        std::size_t anchor_y = 0;
+        std::size_t anchor_x = 0;
+        std::vector<Cell> rest;
+    };
+
+    std::vector<Stencil> stencils;
+    Automaton automaton;
+
+    /// Calls `on_match(match)` for every stencil occurrence whose anchor ends on row `y`
+    template <typename F>
+    auto scan_row(Grid_view grid, std::size_t y, F on_match) const -> void
+    {
+        const Line row{y, 0, grid.extent(1)};
+        scan_line(automaton, grid, Direction::east, row, [&](Automaton::State state, std::size_t k) {
+            for (const auto id : automaton.matches_at(state)) {
+                const auto& stencil = stencils[id];
+                const auto left = static_cast<std::ptrdiff_t>(k + 1 - automaton.pattern_length(id) - stencil.anchor_x);
+                const auto top = static_cast<std::ptrdiff_t>(y - stencil.anchor_y);
+                if (left < 0 || top < 0) continue;
+                const auto x0 = static_cast<std::size_t>(left);
+                const auto y0 = static_cast<std::size_t>(top);
+                if (x0 + stencil.width > grid.extent(1) || y0 + stencil.height > grid.extent(0)) continue;
+                const bool matches = std::ranges::all_of(stencil.rest, [&](const Cell& cell) {
+                    return grid[y0 + cell.y, x0 + cell.x] == cell.c;
+                });
+                if (matches) on_match(Match{id, y0, x0, Direction::east});
+            }
+        });
+    }
+
+public:
+    explicit Stencil_search(std::span<const std::string_view> patterns, char wildcard = '.')
+    {
+        std::vector<std::string_view> anchors;
+        for (const auto pattern : patterns) {
+            Stencil& stencil = stencils.emplace_back();
+            std::string_view anchor;
+            std::size_t y = 0;
+            for (const auto row : pattern | std::views::split('\n')) {
+                const std::string_view text{row.begin(), row.end()};
+                stencil.width = std::max(stencil.width, text.size());
+                for (std::size_t x = 0; x < text.size();) {
+                    if (text[x] == wildcard) {
+                        ++x;
+                        continue;
+                    }
+                    const auto run = text.substr(x, text.find(wildcard, x) - x);
+                    if (run.size() > anchor.size()) {
+                        anchor = run;
+                        stencil.anchor_y = y;
+                        stencil.anchor_x = x;
+                    }
+                    x += run.size();
+                }
+                ++y;
+            }
+            stencil.height = y;
+            if (anchor.empty()) throw std::invalid_argument("a stencil needs at least one cell that is no wildcard");
+            anchors.push_back(anchor);
+
+            y = 0;
+            for (const auto row : pattern | std::views::split('\n')) {
+                const std::string_view text{row.begin(), row.end()};
+                for (std::size_t x = 0; x < text.size(); ++x) {
+                    const bool in_anchor
+                        = y == stencil.anchor_y && x >= stencil.anchor_x && x < stencil.anchor_x + anchor.size();
+                    if (text[x] != wildcard && !in_anchor) stencil.rest.push_back({y, x, text[x]});
+                }
+                ++y;
+            }
+        }
+        automaton = Automaton{anchors};
+    }
+    Stencil_search(std::initializer_list<std::string_view> patterns, char wildcard = '.')
+        : Stencil_search{std::span{patterns.begin(), patterns.size()}, wildcard}
+    {
+    }
+
+    /// Number of occurrences of all stencils
+    auto count(Grid_view grid, std::size_t workers = parallel::worker_count()) const -> std::size_t
+    {
+        const auto counts = map_stripes(grid, std::array{Direction::east}, workers, [&](auto, auto first, auto last) {
+            std::size_t count = 0;
+            for (auto y = first; y < last; ++y) {
+                scan_row(grid, y, [&](const Match&) { ++count; });
+            }
+            return count;
+        });
+        return std::ranges::fold_left(counts, 0uz, std::plus{});
+    }
+
+    /// All occurrences, ordered by the row of their anchor
+    auto find_all(Grid_view grid, std::size_t workers = parallel::worker_count()) const -> std::vector<Match>
+    {
+        return concat(map_stripes(grid, std::array{Direction::east}, workers, [&](auto, auto first, auto last) {
+            std::vector<Match> found;
+            for (auto y = first; y < last; ++y) {
+                scan_row(grid, y, [&](const Match& match) { found.push_back(match); });
+            }
+            return found;
+        }));
+    }
+};
+
+} // namespace utils::grid
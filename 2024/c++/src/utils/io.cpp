@@ -0,0 +1,160 @@
+module;
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+export module utils:io;
+
+import std;
+
+#ifndef AOC_INPUT_DIR
+#define AOC_INPUT_DIR "../inputs"
+#endif
+
+namespace utils::io {
+
+[[noreturn]] auto throw_errno(std::string_view what, const std::filesystem::path& path) -> void
+{
+    throw std::system_error(errno, std::generic_category(), std::format("{} '{}'", what, path.string()));
+}
+
+/// Closes a file descriptor when leaving scope
+struct Fd_guard {
+    int fd;
+    ~Fd_guard() { ::close(fd); }
+};
+
+/// Reads from `fd` until EOF, for sources that cannot be mapped (stdin, pipes, sockets, ...)
+auto read_all(int fd, const std::filesystem::path& path) -> std::string
+{
+    std::string buffer(1uz << 16, '\0');
+    std::size_t size = 0;
+    while (true) {
+        if (size == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        const auto n = ::read(fd, buffer.data() + size, buffer.size() - size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("cannot read", path);
+        }
+        if (n == 0) break;
+        size += static_cast<std::size_t>(n);
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+/// A puzzle input. Regular files are mapped read-only so `view()` points straight into the page cache,
+/// everything else is streamed into an owned buffer.
+export class Input {
+    std::string_view mapping;
+    std::string buffer;
+
+    Input(std::string_view mapping, std::string buffer) : mapping{mapping}, buffer{std::move(buffer)} {}
+
+public:
+    /// Opens `path`, "-" means stdin
+    static auto open(const std::filesystem::path& path) -> Input
+    {
+        if (path == "-") {
+            return Input{{}, read_all(STDIN_FILENO, path)};
+        }
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw_errno("cannot open", path);
+        const Fd_guard guard{fd};
+
+        struct stat info;
+        if (::fstat(fd, &info) < 0) throw_errno("cannot stat", path);
+        if (!S_ISREG(info.st_mode)) {
+            return Input{{}, read_all(fd, path)};
+        }
+
+        const auto size = static_cast<std::size_t>(info.st_size);
+        if (size == 0) {
+            return Input{{}, {}};
+        }
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            return Input{{}, read_all(fd, path)};
+        }
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+        return Input{std::string_view{static_cast<const char*>(addr), size}, {}};
+    }
+
+    Input(const Input&) = delete;
+    auto operator=(const Input&) -> Input& = delete;
+
+    Input(Input&& other) noexcept : mapping{std::exchange(other.mapping, {})}, buffer{std::move(other.buffer)} {}
+    auto operator=(Input&& other) noexcept -> Input&
+    {
+        std::swap(mapping, other.mapping);
+        std::swap(buffer, other.buffer);
+        return *this;
+    }
+
+    ~Input()
+    {
+        if (!mapping.empty()) {
+            ::munmap(const_cast<char*>(mapping.data()), mapping.size());
+        }
+    }
+
+    [[nodiscard]] auto view() const -> std::string_view { return mapping.empty() ? std::string_view{buffer} : mapping; }
+    [[nodiscard]] auto is_mapped() const -> bool { return !mapping.empty(); }
+
+    operator std::string_view() const { return view(); }
+};
+
+/// Reads a file ("-" is stdin) front to back in blocks of a fixed size, so memory use does not depend on its size
+export class Block_reader {
+    std::filesystem::path path;
+    int fd;
+    std::vector<char> buffer;
+
+public:
+    Block_reader(std::filesystem::path file, std::size_t block_size)
+        : path{std::move(file)}, fd{path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC)},
+          buffer(block_size)
+    {
+        if (fd < 0) throw_errno("cannot open", path);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    Block_reader(const Block_reader&) = delete;
+    auto operator=(const Block_reader&) -> Block_reader& = delete;
+
+    ~Block_reader()
+    {
+        if (fd != STDIN_FILENO) ::close(fd);
+    }
+
+    /// The next block, valid until the following call. Only the last block is shorter than the block size, nullopt
+    /// once the input is exhausted.
+    auto next() -> std::optional<std::string_view>
+    {
+        std::size_t size = 0;
+        while (size < buffer.size()) {
+            const auto n = ::read(fd, buffer.data() + size, buffer.size() - size);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw_errno("cannot read", path);
+            }
+            if (n == 0) break;
+            size += static_cast<std::size_t>(n);
+        }
+        if (size == 0) return std::nullopt;
+        return std::string_view{buffer.data(), size};
+    }
+};
+
+/// The default input of a day, `<inputs>/<day>.txt`
+export auto input_path(int day) -> std::filesystem::path
+{
+    return std::filesystem::path{AOC_INPUT_DIR} / std::format("{}.txt", day);
+}
+
+} // namespace utils::io
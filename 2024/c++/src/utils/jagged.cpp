@@ -0,0 +1,152 @@
+export module utils:jagged;
+
+import std;
+
+export namespace utils {
+
+/// Rows of varying length stored back to back in a single buffer. Row `i` is `values[offsets[i], offsets[i + 1])`,
+/// so a whole input costs two allocations instead of one per line.
+template <typename T>
+class Jagged {
+    std::vector<T> values;
+    std::vector<std::size_t> offsets{0};
+
+    template <bool Const>
+    class Row_iterator {
+        using Value = std::conditional_t<Const, const T, T>;
+        Value* values = nullptr;
+        const std::size_t* offset = nullptr;
+
+    public:
+        using iterator_concept = std::random_access_iterator_tag;
+        using value_type = std::span<Value>;
+        using difference_type = std::ptrdiff_t;
+
+        Row_iterator() = default;
+        Row_iterator(Value* values, const std::size_t* offset) : values{values}, offset{offset} {}
+
+        auto operator*() const -> value_type { return {values + offset[0], values + offset[1]}; }
+        auto operator[](difference_type n) const -> value_type { return *(*this + n); }
+
+        auto operator++() -> Row_iterator&
+        {
+            ++offset;
+            return *this;
+        }
+        auto operator++(int) -> Row_iterator
+        {
+            auto copy = *this;
+            ++offset;
+            return copy;
+        }
+        auto operator--() -> Row_iterator&
+        {
+            --offset;
+            return *this;
+        }
+        auto operator--(int) -> Row_iterator
+        {
+            auto copy = *this;
+            --offset;
+            return copy;
+        }
+        auto operator+=(difference_type n) -> Row_iterator&
+        {
+            offset += n;
+            return *this;
+        }
+        auto operator-=(difference_type n) -> Row_iterator&
+        {
+            offset -= n;
+            return *this;
+        }
+
+        friend auto operator+(Row_iterator iter, difference_type n) -> Row_iterator { return iter += n; }
+        friend auto operator+(difference_type n, Row_iterator iter) -> Row_iterator { return iter += n; }
+        friend auto operator-(Row_iterator iter, difference_type n) -> Row_iterator { return iter -= n; }
+        friend auto operator-(Row_iterator lhs, Row_iterator rhs) -> difference_type { return lhs.offset - rhs.offset; }
+        friend auto operator==(Row_iterator lhs, Row_iterator rhs) -> bool { return lhs.offset == rhs.offset; }
+        friend auto operator<=>(Row_iterator lhs, Row_iterator rhs) { return lhs.offset <=> rhs.offset; }
+    };
+
+public:
+    using iterator = Row_iterator<false>;
+    using const_iterator = Row_iterator<true>;
+
+    Jagged() = default;
+
+    auto size() const -> std::size_t { return offsets.size() - 1; }
+    auto empty() const -> bool { return size() == 0; }
+    /// Number of values over all rows
+    auto total_size() const -> std::size_t { return values.size(); }
+
+    auto operator[](std::size_t row) -> std::span<T> { return *(begin() + row); }
+    auto operator[](std::size_t row) const -> std::span<const T> { return *(begin() + row); }
+
+    auto begin() -> iterator { return {values.data(), offsets.data()}; }
+    auto end() -> iterator { return {values.data(), offsets.data() + size()}; }
+    auto begin() const -> const_iterator { return {values.data(), offsets.data()}; }
+    auto end() const -> const_iterator { return {values.data(), offsets.data() + size()}; }
+
+    /// All values, row after row
+    auto flat() -> std::span<T> { return values; }
+    auto flat() const -> std::span<const T> { return values; }
+
+    auto reserve(std::size_t rows, std::size_t total_values) -> void
+    {
+        offsets.reserve(rows + 1);
+        values.reserve(total_values);
+    }
+
+    /// Appends a copy of `row` as the last row
+    auto push_row(std::ranges::input_range auto&& row) -> std::span<T>
+    {
+        std::ranges::copy(row, std::back_inserter(values));
+        offsets.push_back(values.size());
+        return (*this)[size() - 1];
+    }
+
+    /// Appends a value to the row that is currently being built, see `finish_row`
+    auto push_value(T value) -> void { values.push_back(std::move(value)); }
+    /// Closes the row built by `push_value` calls since the last row was finished
+    auto finish_row() -> std::span<T>
+    {
+        offsets.push_back(values.size());
+        return (*this)[size() - 1];
+    }
+
+    /// Appends a row by letting `fill` write straight into the buffer. `fill` gets room for `max_size` values and
+    /// returns how many it actually wrote.
+    template <std::invocable<std::span<T>> F>
+        requires std::convertible_to<std::invoke_result_t<F, std::span<T>>, std::size_t>
+    auto emplace_row(std::size_t max_size, F fill) -> std::span<T>
+    {
+        const auto row_begin = values.size();
+        values.resize(row_begin + max_size);
+        const std::size_t written = fill(std::span{values}.subspan(row_begin, max_size));
+        values.resize(row_begin + written);
+        offsets.push_back(values.size());
+        return (*this)[size() - 1];
+    }
+};
+
+/// Collects a range of ranges into a `Jagged<T>`, so parse pipelines can end in `| utils::to_jagged<T>`
+template <typename T>
+struct To_jagged_closure : std::ranges::range_adaptor_closure<To_jagged_closure<T>> {
+    static constexpr auto operator()(std::ranges::input_range auto&& rows) -> Jagged<T>
+    {
+        Jagged<T> jagged;
+        for (auto&& row : rows) {
+            jagged.push_row(row);
+        }
+        return jagged;
+    }
+};
+
+template <typename T>
+inline constexpr To_jagged_closure<T> to_jagged;
+
+} // namespace utils
+
+static_assert(std::ranges::random_access_range<utils::Jagged<int>>);
+static_assert(std::ranges::random_access_range<const utils::Jagged<int>>);
@@ -0,0 +1,38 @@
+export module utils:parallel;
+
+import std;
+
+export namespace utils::parallel {
+
+/// Number of threads to spread work over, at least 1
+auto worker_count() -> std::size_t { return std::max(1u, std::thread::hardware_concurrency()); }
+
+/// Calls `func(i)` for every i in [0, count) on up to `workers` threads, the calling thread included. Indices are
+/// handed out one by one from a shared counter, so tasks of uneven cost still keep every worker busy.
+template <typename F>
+    requires std::invocable<F&, std::size_t>
+auto for_each_index(std::size_t count, F func, std::size_t workers = worker_count()) -> void
+{
+    workers = std::min(workers, count);
+    if (workers <= 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next{0};
+    const auto work = [&] {
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            func(i);
+        }
+    };
+    std::vector<std::jthread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+}
+
+} // namespace utils::parallel
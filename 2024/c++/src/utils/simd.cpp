@@ -0,0 +1,234 @@
+module;
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define UTILS_SIMD_X86 1
+#endif
+
+export module utils:simd;
+
+import std;
+
+namespace utils::simd {
+
+using Find_byte_fn = auto (*)(const char*, const char*, char) -> const char*;
+using Find_literal_fn = auto (*)(const char*, const char*, std::string_view) -> const char*;
+using Find_either_fn = auto (*)(const char*, const char*, char, char) -> const char*;
+using Byte_masks_fn = auto (*)(const char*, std::size_t, char, std::uint64_t*) -> void;
+
+auto find_byte_scalar(const char* first, const char* last, char c) -> const char*
+{
+    const void* found = std::memchr(first, c, static_cast<std::size_t>(last - first));
+    return found ? static_cast<const char*>(found) : last;
+}
+
+auto find_either_scalar(const char* first, const char* last, char a, char b) -> const char*
+{
+    return std::find_if(first, last, [=](char c) { return c == a || c == b; });
+}
+
+auto byte_masks_scalar(const char* first, std::size_t size, char c, std::uint64_t* out) -> void
+{
+    for (std::size_t word = 0; word * 64 < size; ++word) {
+        const auto n = std::min(size - word * 64, 64uz);
+        std::uint64_t mask = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            mask |= std::uint64_t{first[word * 64 + i] == c} << i;
+        }
+        out[word] = mask;
+    }
+}
+
+/// Checks every candidate start position in [first, stop) against `needle`
+auto find_literal_scalar(const char* first, const char* last, std::string_view needle) -> const char*
+{
+    const char* const stop = last - needle.size() + 1;
+    for (; first < stop; ++first) {
+        first = find_byte_scalar(first, stop, needle.front());
+        if (first == stop) break;
+        if (std::memcmp(first + 1, needle.data() + 1, needle.size() - 1) == 0) return first;
+    }
+    return last;
+}
+
+#ifdef UTILS_SIMD_X86
+
+auto find_byte_sse2(const char* first, const char* last, char c) -> const char*
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    for (; last - first >= 16; first += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        if (mask != 0) return first + std::countr_zero(mask);
+    }
+    return find_byte_scalar(first, last, c);
+}
+
+[[gnu::target("avx2")]] auto find_byte_avx2(const char* first, const char* last, char c) -> const char*
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    for (; last - first >= 32; first += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask != 0) return first + std::countr_zero(mask);
+    }
+    return find_byte_sse2(first, last, c);
+}
+
+auto find_either_sse2(const char* first, const char* last, char a, char b) -> const char*
+{
+    const __m128i needle_a = _mm_set1_epi8(a);
+    const __m128i needle_b = _mm_set1_epi8(b);
+    for (; last - first >= 16; first += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, needle_a), _mm_cmpeq_epi8(chunk, needle_b)))
+        );
+        if (mask != 0) return first + std::countr_zero(mask);
+    }
+    return find_either_scalar(first, last, a, b);
+}
+
+[[gnu::target("avx2")]] auto find_either_avx2(const char* first, const char* last, char a, char b) -> const char*
+{
+    const __m256i needle_a = _mm256_set1_epi8(a);
+    const __m256i needle_b = _mm256_set1_epi8(b);
+    for (; last - first >= 32; first += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, needle_a), _mm256_cmpeq_epi8(chunk, needle_b));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(matches));
+        if (mask != 0) return first + std::countr_zero(mask);
+    }
+    return find_either_sse2(first, last, a, b);
+}
+
+auto byte_masks_sse2(const char* first, std::size_t size, char c, std::uint64_t* out) -> void
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    std::size_t word = 0;
+    for (; (word + 1) * 64 <= size; ++word) {
+        std::uint64_t mask = 0;
+        for (std::size_t lane = 0; lane < 4; ++lane) {
+            const auto* chunk = reinterpret_cast<const __m128i*>(first + word * 64 + lane * 16);
+            const auto bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(chunk), needle)));
+            mask |= std::uint64_t{bits} << (lane * 16);
+        }
+        out[word] = mask;
+    }
+    byte_masks_scalar(first + word * 64, size - word * 64, c, out + word);
+}
+
+[[gnu::target("avx2")]] auto byte_masks_avx2(const char* first, std::size_t size, char c, std::uint64_t* out) -> void
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    std::size_t word = 0;
+    for (; (word + 1) * 64 <= size; ++word) {
+        const auto* low = reinterpret_cast<const __m256i*>(first + word * 64);
+        const auto* high = reinterpret_cast<const __m256i*>(first + word * 64 + 32);
+        const auto low_bits
+            = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(low), needle)));
+        const auto high_bits
+            = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(high), needle)));
+        out[word] = std::uint64_t{low_bits} | (std::uint64_t{high_bits} << 32);
+    }
+    byte_masks_scalar(first + word * 64, size - word * 64, c, out + word);
+}
+
+/// Compares the first and the last byte of `needle` against 16 start positions at once and only verifies the
+/// positions where both match
+auto find_literal_sse2(const char* first, const char* last, std::string_view needle) -> const char*
+{
+    const auto n = needle.size();
+    const char* const stop = last - n + 1;
+    const __m128i head = _mm_set1_epi8(needle.front());
+    const __m128i tail = _mm_set1_epi8(needle.back());
+    for (; stop - first >= 16; first += 16) {
+        const __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const __m128i tails = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + n - 1));
+        auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(heads, head), _mm_cmpeq_epi8(tails, tail)))
+        );
+        for (; mask != 0; mask &= mask - 1) {
+            const char* candidate = first + std::countr_zero(mask);
+            if (std::memcmp(candidate + 1, needle.data() + 1, n - 1) == 0) return candidate;
+        }
+    }
+    return find_literal_scalar(first, last, needle);
+}
+
+[[gnu::target("avx2")]] auto find_literal_avx2(const char* first, const char* last, std::string_view needle)
+    -> const char*
+{
+    const auto n = needle.size();
+    const char* const stop = last - n + 1;
+    const __m256i head = _mm256_set1_epi8(needle.front());
+    const __m256i tail = _mm256_set1_epi8(needle.back());
+    for (; stop - first >= 32; first += 32) {
+        const __m256i heads = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        const __m256i tails = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + n - 1));
+        auto mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(heads, head), _mm256_cmpeq_epi8(tails, tail)))
+        );
+        for (; mask != 0; mask &= mask - 1) {
+            const char* candidate = first + std::countr_zero(mask);
+            if (std::memcmp(candidate + 1, needle.data() + 1, n - 1) == 0) return candidate;
+        }
+    }
+    return find_literal_sse2(first, last, needle);
+}
+
+auto has_avx2() -> bool
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+const Find_byte_fn find_byte_impl = has_avx2() ? find_byte_avx2 : find_byte_sse2;
+const Find_literal_fn find_literal_impl = has_avx2() ? find_literal_avx2 : find_literal_sse2;
+const Find_either_fn find_either_impl = has_avx2() ? find_either_avx2 : find_either_sse2;
+const Byte_masks_fn byte_masks_impl = has_avx2() ? byte_masks_avx2 : byte_masks_sse2;
+
+#else
+
+const Find_byte_fn find_byte_impl = find_byte_scalar;
+const Find_literal_fn find_literal_impl = find_literal_scalar;
+const Find_either_fn find_either_impl = find_either_scalar;
+const Byte_masks_fn byte_masks_impl = byte_masks_scalar;
+
+#endif
+
+/// Returns the position of the first `c` in `text`, or npos
+export auto find(std::string_view text, char c) -> std::size_t
+{
+    const char* const last = text.data() + text.size();
+    const char* found = find_byte_impl(text.data(), last, c);
+    return found == last ? std::string_view::npos : static_cast<std::size_t>(found - text.data());
+}
+
+/// Returns the position of the first byte in `text` that is `a` or `b`, or npos
+export auto find_either(std::string_view text, char a, char b) -> std::size_t
+{
+    const char* const last = text.data() + text.size();
+    const char* found = find_either_impl(text.data(), last, a, b);
+    return found == last ? std::string_view::npos : static_cast<std::size_t>(found - text.data());
+}
+
+/// Sets bit i % 64 of `out[i / 64]` iff `text[i] == c`, bits past the end of `text` are cleared. `out` needs room for
+/// `(text.size() + 63) / 64` words.
+export auto byte_masks(std::string_view text, char c, std::span<std::uint64_t> out) -> void
+{
+    byte_masks_impl(text.data(), text.size(), c, out.data());
+}
+
+/// Returns the position of the first occurrence of `needle` in `text`, or npos. An empty needle never matches.
+export auto find(std::string_view text, std::string_view needle) -> std::size_t
+{
+    if (needle.empty() || needle.size() > text.size()) return std::string_view::npos;
+    if (needle.size() == 1) return find(text, needle.front());
+
+    const char* const last = text.data() + text.size();
+    const char* found = find_literal_impl(text.data(), last, needle);
+    return found == last ? std::string_view::npos : static_cast<std::size_t>(found - text.data());
+}
+
+} // namespace utils::simd
@@ -1,6 +1,7 @@
 export module utils:strings;
 import std;
 import :core;
+import :simd;
 
 namespace utils::strings {
 
@@ -15,6 +16,13 @@ concept StringViewPatternFunc = std::same_as<std::size_t, std::invoke_result_t<F
 template <typename F>
 concept PatternFunc = std::predicate<F, char> || StringViewPatternFunc<F>;
 
+/// A pattern that can locate its next match itself instead of being probed at every position
+template <typename P>
+concept Searchable_pattern = StringViewPatternFunc<P> && requires(const P& pattern, std::string_view text) {
+    { pattern.find(text) } -> std::same_as<std::size_t>;
+    { pattern.size() } -> std::same_as<std::size_t>;
+};
+
 template <typename T>
 concept Pattern = std::same_as<char, T>             //
                || std::same_as<std::string_view, T> //
@@ -45,6 +53,7 @@ public:
         sub_end_pos = other.sub_end_pos;
         end = other.end;
         next_sub_begin_pos = other.next_sub_begin_pos;
+        return *this;
     }
 
     Split_view_iter(std::string_view text, PatFunc pattern_func)
@@ -65,6 +74,13 @@ public:
         self.sub_begin_pos = self.next_sub_begin_pos;
         self.sub_end_pos = self.sub_begin_pos;
         std::size_t consumed = 0;
+        if constexpr (Searchable_pattern<PatFunc>) {
+            const auto pos = self.pattern_func.find(std::string_view{self.sub_begin_pos, self.end});
+            self.sub_end_pos = pos == std::string_view::npos ? self.end : self.sub_begin_pos + pos;
+            consumed = pos == std::string_view::npos ? 1 : self.pattern_func.size();
+            self.next_sub_begin_pos = self.sub_end_pos + consumed;
+            return self;
+        }
         while (true) {
             auto remainder = std::string_view{self.sub_end_pos, self.end};
             consumed = self.pattern_func(remainder);
@@ -97,7 +113,7 @@ public:
     }
     friend auto operator==(const Split_view_iter& lhs, const Split_view_iter& rhs) -> bool
     {
-        lhs.sub_begin_pos == rhs.sub_begin_pos&& lhs.sub_end_pos == rhs.sub_end_pos&& lhs.end == rhs.end;
+        return lhs.sub_begin_pos == rhs.sub_begin_pos && lhs.sub_end_pos == rhs.sub_end_pos && lhs.end == rhs.end;
     }
 };
 
@@ -118,18 +134,32 @@ struct Split_view : std::ranges::view_interface<Split_view<T>> {
 
 static_assert(Range_of<std::string_view, char>);
 
-constexpr auto bake_pattern(char pattern) -> PatternFunc auto
-{
-    return [pattern](Range_of<char> auto to_match) -> std::size_t {
+/// Matches a single character, searched for with SIMD
+struct Char_pattern {
+    char pattern;
+
+    constexpr auto operator()(Range_of<char> auto to_match) const -> std::size_t
+    {
         return !std::ranges::empty(to_match) && *std::ranges::begin(to_match) == pattern ? 1 : 0;
-    };
-}
-constexpr auto bake_pattern(std::string_view pattern) -> PatternFunc auto
-{
-    return [pattern](Range_of<char> auto to_match) -> std::size_t {
+    }
+    auto find(std::string_view text) const -> std::size_t { return simd::find(text, pattern); }
+    constexpr auto size() const -> std::size_t { return 1; }
+};
+
+/// Matches a literal string, searched for with SIMD
+struct Literal_pattern {
+    std::string_view pattern;
+
+    constexpr auto operator()(Range_of<char> auto to_match) const -> std::size_t
+    {
         return !std::ranges::empty(to_match) && std::ranges::starts_with(to_match, pattern) ? pattern.size() : 0;
-    };
-}
+    }
+    auto find(std::string_view text) const -> std::size_t { return simd::find(text, pattern); }
+    constexpr auto size() const -> std::size_t { return pattern.size(); }
+};
+
+constexpr auto bake_pattern(char pattern) -> Char_pattern { return Char_pattern{pattern}; }
+constexpr auto bake_pattern(std::string_view pattern) -> Literal_pattern { return Literal_pattern{pattern}; }
 constexpr auto bake_pattern(const char* pattern) -> PatternFunc auto { return bake_pattern(std::string_view{pattern}); }
 constexpr auto bake_pattern(std::predicate<char> auto pattern) -> PatternFunc auto
 {
@@ -203,6 +233,14 @@ export inline constexpr struct Trim_adaptor : std::ranges::range_adaptor_closure
 export auto count_matches(Range_of<char> auto range, Pattern auto pattern) -> std::size_t
 {
     auto baked = bake_pattern(pattern);
+    if constexpr (Searchable_pattern<decltype(baked)> && Sv_like<decltype(range)>) {
+        std::string_view rest{std::ranges::begin(range), std::ranges::end(range)};
+        std::size_t count = 0;
+        for (std::size_t pos; (pos = baked.find(rest)) != std::string_view::npos; ++count) {
+            rest.remove_prefix(pos + baked.size());
+        }
+        return count;
+    }
     auto iter = std::ranges::begin(range);
     auto end = std::ranges::end(range);
     std::size_t count = 0;
@@ -278,4 +316,101 @@ export template <std::integral I>
 inline constexpr auto parse_num_value = compose(opt_value, parse_num<I>);
 
 
+inline constexpr auto is_digit = [](char c) -> bool { return static_cast<unsigned char>(c - '0') < 10; };
+
+/// 10^i for every power of ten a std::uint64_t can hold
+export inline constexpr auto powers_of_ten = [] {
+    std::array<std::uint64_t, 20> powers{};
+    std::uint64_t power = 1;
+    for (auto& p : powers) {
+        p = power;
+        power *= 10;
+    }
+    return powers;
+}();
+
+/// Number of decimal digits of `n`, 1 for 0. Estimates log10 from the bit width and corrects it with one comparison.
+export constexpr auto digit_count(std::uint64_t n) -> std::size_t
+{
+    n |= 1;
+    const auto guess = (static_cast<std::size_t>(std::bit_width(n)) * 1233) >> 12;
+    return guess + (n >= powers_of_ten[guess] ? 1 : 0);
+}
+
+/// Index of the first byte of `chunk` that is not an ascii digit, 8 if all are
+constexpr auto digit_run_length(std::uint64_t chunk) -> std::size_t
+{
+    constexpr std::uint64_t high_nibbles = 0xF0F0F0F0F0F0F0F0;
+    constexpr std::uint64_t zeros = 0x3030303030303030;
+    // a byte is a digit iff its high nibble is 3 both before and after adding 6. carries only move towards
+    // later bytes, so the first flagged byte is always correct
+    const auto non_digits = ((chunk & high_nibbles) ^ zeros) | (((chunk + 0x0606060606060606) & high_nibbles) ^ zeros);
+    return static_cast<std::size_t>(std::countr_zero(non_digits)) / 8;
+}
+
+/// Value of the first `n` (1 to 8) ascii digits of a little endian `chunk`, combining neighbouring lanes in
+/// three multiplications instead of one per digit
+constexpr auto swar_digits(std::uint64_t chunk, std::size_t n) -> std::uint64_t
+{
+    chunk = (chunk << (8 * (8 - n))) & 0x0F0F0F0F0F0F0F0F;
+    chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FF;
+    chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFF;
+    return (chunk * 10000 + (chunk >> 32)) & 0x00000000FFFFFFFF;
+}
+
+/// Consumes the digits starting at `pos`, 8 at a time while at least 8 bytes are left
+template <std::unsigned_integral U>
+constexpr auto parse_digits(const char*& pos, const char* last) -> U
+{
+    U value = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        if !consteval {
+            while (last - pos >= 8) {
+                std::uint64_t chunk;
+                std::memcpy(&chunk, pos, sizeof(chunk));
+                const auto n = digit_run_length(chunk);
+                if (n == 0) return value;
+                value = static_cast<U>(value * powers_of_ten[n] + swar_digits(chunk, n));
+                pos += n;
+                if (n < 8) return value;
+            }
+        }
+    }
+    for (; pos != last && is_digit(*pos); ++pos) {
+        value = static_cast<U>(value * 10 + static_cast<U>(*pos - '0'));
+    }
+    return value;
+}
+
+/// Decodes the integers in `text` into `out` and returns the filled part of it. Anything that is not a digit (or a
+/// leading '-' for signed `I`) separates numbers, values have to fit into `I`. Stops early once `out` is full,
+/// `text.size() / 2 + 1` elements are always enough.
+export template <std::integral I>
+constexpr auto parse_ints(std::string_view text, std::span<I> out) -> std::span<I>
+{
+    using U = std::make_unsigned_t<I>;
+    const char* pos = text.data();
+    const char* const last = pos + text.size();
+    std::size_t count = 0;
+    while (count < out.size()) {
+        while (pos != last && !is_digit(*pos) && (!std::is_signed_v<I> || *pos != '-')) {
+            ++pos;
+        }
+        if (pos == last) break;
+
+        bool negative = false;
+        if constexpr (std::is_signed_v<I>) {
+            if (*pos == '-') {
+                ++pos;
+                if (pos == last || !is_digit(*pos)) continue;
+                negative = true;
+            }
+        }
+        const auto value = parse_digits<U>(pos, last);
+        out[count++] = static_cast<I>(negative ? U{0} - value : value);
+    }
+    return out.first(count);
+}
+
+
 } // namespace utils::strings
@@ -6,3 +6,10 @@ export import :core;
 export import :assert;
 export import :pretty;
 export import :strings;
+export import :simd;
+export import :io;
+export import :bench;
+export import :jagged;
+export import :parallel;
+export import :grid;
+export import :day;